@@ -0,0 +1,181 @@
+"""
+Build step that shrinks the GFX fonts used by the display to the characters the firmware can render.
+
+Fonts are picked up from `#include <subset/<Font>.h>` lines in src/Display. The characters are collected
+from the strings handed to the renderer (label/unit constants, literals passed to the draw helpers and
+snprintf formats, with format specifiers expanded to the characters they can produce). For every font a
+header with the same symbol names is written to include/subset/, its glyph table limited to the range of
+used characters and its bitmap limited to the used glyphs. Glyph table and font are emitted as constexpr so
+the display layout can be derived from the font metrics at compile time (src/Display/layout.hpp).
+
+Runs as a PlatformIO pre-build script (extra_scripts = pre:scripts/subset_fonts.py) or standalone:
+    python scripts/subset_fonts.py [font directory ...]
+"""
+
+import glob
+import os
+import re
+import sys
+
+GLYPH_SIZE = 8  # sizeof(GFXglyph) including padding
+FONT_SIZE = 12  # sizeof(GFXfont)
+
+FONT_INCLUDE = re.compile(r"#include\s*<subset/(\w+)\.h>")
+RENDERED_STRINGS = [
+    re.compile(r"constexpr\s+const\s+char\s*\*\s*(?:LABEL|UNIT)_\w+\s*=\s*\"((?:[^\"\\]|\\.)*)\""),
+    re.compile(r"(?:drawCenteredText|drawValueWithUnit|printText)\(\s*\"((?:[^\"\\]|\\.)*)\""),
+    re.compile(r"snprintf\([^,]+,[^,]+,\s*\"((?:[^\"\\]|\\.)*)\""),
+]
+FORMAT_SPECIFIER = re.compile(r"%[-+ 0#]*\d*(?:\.\d+)?(?:hh|h|l|ll)?([%diuxXc])")
+SPECIFIER_CHARS = {
+    "%": "%",
+    "d": "-0123456789",
+    "i": "-0123456789",
+    "u": "0123456789",
+    "x": "0123456789abcdef",
+    "X": "0123456789ABCDEF",
+}
+
+
+def project_dir():
+    return os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+
+def collect_sources(root):
+    sources = []
+    for pattern in ("*.cpp", "*.hpp", "*.h"):
+        sources += glob.glob(os.path.join(root, "src", "Display", pattern))
+    return [open(path, encoding="utf-8").read() for path in sorted(sources)]
+
+
+def collect_fonts(sources):
+    fonts = []
+    for source in sources:
+        for name in FONT_INCLUDE.findall(source):
+            if name not in fonts:
+                fonts.append(name)
+    return fonts
+
+
+def collect_charset(sources):
+    charset = set()
+    for source in sources:
+        for pattern in RENDERED_STRINGS:
+            for text in pattern.findall(source):
+                text = bytes(text, "utf-8").decode("unicode_escape")
+                for specifier in FORMAT_SPECIFIER.findall(text):
+                    charset.update(SPECIFIER_CHARS.get(specifier, ""))
+                charset.update(c for c in FORMAT_SPECIFIER.sub("", text) if " " <= c <= "~")
+    return charset
+
+
+def find_font(name, font_dirs):
+    for directory in font_dirs:
+        path = os.path.join(directory, name + ".h")
+        if os.path.isfile(path):
+            return path
+    raise FileNotFoundError("Font %s not found in %s" % (name, ", ".join(font_dirs)))
+
+
+def parse_font(name, path):
+    text = open(path, encoding="utf-8").read()
+    bitmap = re.search(r"%sBitmaps\[\]\s*PROGMEM\s*=\s*\{(.*?)\};" % name, text, re.S).group(1)
+    glyphs = re.search(r"%sGlyphs\[\]\s*PROGMEM\s*=\s*\{(.*?)\};" % name, text, re.S).group(1)
+    header = re.search(r"GFXfont\s+%s\s+PROGMEM\s*=\s*\{.*?,.*?,\s*(\w+),\s*(\w+),\s*(\w+)\s*\}" % name, text, re.S)
+    return {
+        "bitmap": [int(value, 16) for value in re.findall(r"0x[0-9A-Fa-f]{2}", bitmap)],
+        "glyphs": [tuple(int(v) for v in entry) for entry in
+                   re.findall(r"\{\s*(\d+),\s*(\d+),\s*(\d+),\s*(\d+),\s*(-?\d+),\s*(-?\d+)\s*\}", glyphs)],
+        "first": int(header.group(1), 0),
+        "last": int(header.group(2), 0),
+        "yAdvance": int(header.group(3), 0),
+    }
+
+
+def subset_font(font, charset):
+    codes = sorted(ord(c) for c in charset if font["first"] <= ord(c) <= font["last"])
+    first, last = codes[0], codes[-1]
+    bitmap, glyphs = [], []
+    for code in range(first, last + 1):
+        offset, width, height, x_advance, x_offset, y_offset = font["glyphs"][code - font["first"]]
+        if chr(code) in charset and width and height:
+            size = (width * height + 7) // 8
+            glyphs.append((len(bitmap), width, height, x_advance, x_offset, y_offset))
+            bitmap += font["bitmap"][offset:offset + size]
+        else:
+            # Unused characters keep their advance so cursor arithmetic stays valid
+            glyphs.append((0, 0, 0, x_advance, 0, 0))
+    return {"bitmap": bitmap or [0], "glyphs": glyphs, "first": first, "last": last, "yAdvance": font["yAdvance"]}
+
+
+def font_size(font):
+    return len(font["bitmap"]) + len(font["glyphs"]) * GLYPH_SIZE + FONT_SIZE
+
+
+def render_header(name, font):
+    lines = [
+        "// Generated by scripts/subset_fonts.py, do not edit",
+        "#pragma once",
+        "#include <Adafruit_GFX.h>",
+        "",
+        "const uint8_t %sBitmaps[] PROGMEM = {" % name,
+    ]
+    for i in range(0, len(font["bitmap"]), 12):
+        lines.append("  " + ", ".join("0x%02X" % b for b in font["bitmap"][i:i + 12]) + ",")
+    lines += ["};", "", "constexpr GFXglyph %sGlyphs[] PROGMEM = {" % name]
+    for code, glyph in enumerate(font["glyphs"], font["first"]):
+        lines.append("  { %5d, %3d, %3d, %3d, %4d, %4d },   // 0x%02X %r" % (glyph + (code, chr(code))))
+    lines += [
+        "};",
+        "",
+        "constexpr GFXfont %s PROGMEM = {" % name,
+        "  (uint8_t  *)%sBitmaps," % name,
+        "  (GFXglyph *)%sGlyphs," % name,
+        "  0x%02X, 0x%02X, %d };" % (font["first"], font["last"], font["yAdvance"]),
+        "",
+    ]
+    return "\n".join(lines)
+
+
+def write_if_changed(path, content):
+    if os.path.isfile(path) and open(path, encoding="utf-8").read() == content:
+        return
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "w", encoding="utf-8") as file:
+        file.write(content)
+
+
+def generate(root, font_dirs):
+    sources = collect_sources(root)
+    charset = collect_charset(sources)
+    print("Font subset characters: %s" % "".join(sorted(charset)))
+    saved = 0
+    for name in collect_fonts(sources):
+        font = parse_font(name, find_font(name, font_dirs))
+        subset = subset_font(font, charset)
+        write_if_changed(os.path.join(root, "include", "subset", name + ".h"), render_header(name, subset))
+        before, after = font_size(font), font_size(subset)
+        saved += before - after
+        print("  %-22s %3d -> %3d glyphs, %6d -> %6d bytes (saved %d)" %
+              (name, len(font["glyphs"]), len(subset["glyphs"]), before, after, before - after))
+    print("Font subsetting saved %d bytes of flash" % saved)
+
+
+def default_font_dirs(root, libdeps_dirs):
+    dirs = [os.path.join(root, "include")]
+    for libdeps in libdeps_dirs:
+        dirs += glob.glob(os.path.join(libdeps, "*", "Fonts"))
+    return dirs
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+except NameError:
+    env = None
+
+if env is not None:
+    generate(env.subst("$PROJECT_DIR"),
+             default_font_dirs(env.subst("$PROJECT_DIR"), [env.subst("$PROJECT_LIBDEPS_DIR/$PIOENV")]))
+elif __name__ == "__main__":
+    root = project_dir()
+    generate(root, default_font_dirs(root, glob.glob(os.path.join(root, ".pio", "libdeps", "*"))) + sys.argv[1:])
@@ -9,7 +9,7 @@ namespace
     {
         uint8_t battery;
         uint16_t humidity;
-        uint16_t temperature;
+        int16_t temperature; // BTHome sends the temperature signed
         uint16_t carbonDioxide;
         uint16_t voltage;
 
@@ -47,7 +47,7 @@ void bleInit()
     BLEDevice::init(DEVICE_NAME);
 }
 
-void bleUpdatePayload(uint16_t humidity, uint16_t temperature, uint16_t carbonDioxide, uint16_t voltage, uint8_t battery)
+void bleUpdatePayload(uint16_t humidity, int16_t temperature, uint16_t carbonDioxide, uint16_t voltage, uint8_t battery)
 {
     Serial.printf("Updating BLE payload with Humidity: %d, Temperature: %d, CO2: %d, Voltage: %d, Battery: %d\n",
                   humidity, temperature, carbonDioxide, voltage, battery);
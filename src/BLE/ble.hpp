@@ -17,5 +17,5 @@ namespace BTHOME
 
 void bleInit();
 void bleStopAdvertising();
-void bleUpdatePayload(uint16_t humidity, uint16_t temperature,
+void bleUpdatePayload(uint16_t humidity, int16_t temperature,
                       uint16_t carbonDioxide, uint16_t voltage, uint8_t battery);
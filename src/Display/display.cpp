@@ -1,294 +1,1058 @@
 #include "display.hpp"
+#include "renderer.hpp"
+#include "staticLayer.hpp"
+#include "frameSnapshot.hpp"
+#include "panel.hpp"
+#include "frameBuffer.hpp"
 
 #include <SPI.h>
 #include <GxEPD2_BW.h>
-#include <FreeMonoBold36pt7b.h>
-#include <FreeMonoBold30pt7b.h>
-#include <Fonts/FreeMonoBold24pt7b.h>
-#include <Fonts/FreeMonoBold12pt7b.h>
-#include <Fonts/FreeMonoBold9pt7b.h>
 #include <esp_sleep.h>
 #include <driver/gpio.h>
+#include <time.h>
+#ifdef DISPLAY_BENCHMARK
+#include <subset/FreeMonoBold24pt7b.h>
+#include "segmentFont.hpp"
+#endif
 
 namespace
 {
-    // Display object for 4.2" 400x300 (GDEH042Z15)
-    GxEPD2_BW<GxEPD2_420_GDEY042T81, GxEPD2_420_GDEY042T81::HEIGHT> display(GxEPD2_420_GDEY042T81(PIN_CS, PIN_DC, PIN_RST, PIN_BUSY));
-    constexpr uint16_t DISPLAY_BUSY_SLEEP = 3;                               // Time to wait in light sleep for display to finish updating
-    constexpr uint16_t DISPLAY_FULL_REFRESH_INTERVAL = 200;                  // Number of partial updates before full refresh
-    constexpr uint16_t DISPLAY_WIDTH = GxEPD2_420_GDEY042T81::WIDTH_VISIBLE; // Width of the display
-    constexpr uint16_t DISPLAY_HEIGHT = GxEPD2_420_GDEY042T81::HEIGHT;       // Height of the display
-    constexpr uint16_t DISPLAY_MARGIN = 2;                                   // Margin around the display
-    constexpr uint16_t DISPLAY_CENTER_X = DISPLAY_WIDTH / 2;                 // Center X position
-    constexpr uint16_t DISPLAY_CENTER_Y = DISPLAY_HEIGHT / 2;                // Center Y position
-    constexpr uint16_t UNIT_SPACING = 12;                                    // Spacing between value and unit
-    constexpr uint16_t BATTERY_ICON_WIDTH = 20;                              // Width of the battery icon
-    constexpr uint16_t BATTERY_ICON_HEIGHT = 15;                             // Height of the battery icon
-    constexpr const char *LABEL_HUMIDITY = "Humidity";
-    constexpr const char *LABEL_TEMPERATURE = "Temperature";
-    constexpr const char *LABEL_CO2 = "CO2";
-    constexpr const char *UNIT_PERCENT = "%";
-    constexpr const char *UNIT_CELSIUS = "C";
-    constexpr const char *UNIT_PPM = "ppm";
-
-    // Font definitions
-    constexpr auto FONT_CO2 = &FreeMonoBold30pt7b;         // Font for CO2 value
-    constexpr auto FONT_LABEL = &FreeMonoBold12pt7b;       // Font for labels
-    constexpr auto FONT_UNIT = &FreeMonoBold9pt7b;         // Font for units (%, C, ppm)
-    constexpr auto FONT_CLOCK = &FreeMonoBold12pt7b;       // Font for clock
-    constexpr auto FONT_HUMIDITY = &FreeMonoBold24pt7b;    // Font for humidity
-    constexpr auto FONT_TEMPERATURE = &FreeMonoBold24pt7b; // Font for temperature
-
-    // Clock positions (top left corner)
-    constexpr uint16_t CLOCK_X = DISPLAY_MARGIN;
-    constexpr uint16_t CLOCK_Y = DISPLAY_MARGIN + 18;
-
-    // Battery icon positions (top right corner)
-    constexpr uint16_t BATTERY_ICON_X = DISPLAY_WIDTH - DISPLAY_MARGIN - BATTERY_ICON_WIDTH - 10;
-    constexpr uint16_t BATTERY_ICON_Y = DISPLAY_MARGIN + 2;
+    // Panel driver for the panel selected in panelConfig.hpp and the frame buffer all widgets are rendered into
+    Panel panel(PIN_CS, PIN_DC, PIN_RST, PIN_BUSY);
+#ifdef DISPLAY_PAGE_HEIGHT
+    constexpr uint16_t PAGE_HEIGHT = DISPLAY_PAGE_HEIGHT;  // Rows of the frame rendered at a time
+    uint8_t snapshotScratch[FrameSnapshot::BUDGET];        // New frame snapshot while the stored one is still read
+    uint8_t *const SNAPSHOT_SCRATCH = snapshotScratch;
+#else
+    constexpr uint16_t PAGE_HEIGHT = Panel::HEIGHT;
+    uint8_t *const SNAPSHOT_SCRATCH = nullptr; // A single page is diffed completely before it is stored
+#endif
+    DisplayBuffer display(PAGE_HEIGHT);
+    constexpr uint32_t DISPLAY_BUSY_TIMEOUT = 10000;                           // Longest time in ms to wait for the display to finish updating
+    constexpr uint32_t GHOSTING_BUDGET = 2UL * DISPLAY_WIDTH * DISPLAY_HEIGHT; // Weighted toggled pixels allowed before a full refresh
+    constexpr uint32_t GHOSTING_UPDATE_COST = 300;                             // Budget charged for every partial refresh, even without toggled pixels
+    constexpr int16_t GHOSTING_COOL = 15;                                      // Below this temperature in C toggled pixels count 1.5 times
+    constexpr int16_t GHOSTING_COLD = 5;                                       // Below this temperature in C toggled pixels count twice
+    constexpr int16_t WAVEFORM_COLD_BELOW = 10;                                // Below this temperature in C the panel picks its waveforms itself
+    constexpr int16_t WAVEFORM_FAST_FROM = 20;                                 // From this temperature in C full refreshes use the fast waveform
+    constexpr int16_t WAVEFORM_FAST_UNTIL = 35;                                // Up to this temperature in C full refreshes use the fast waveform
+    constexpr uint8_t MAX_WINDOWS = 8;                                         // Maximum number of windows transferred on a partial update
+    constexpr uint8_t WINDOW_ROW_GAP = 4;                                      // Unchanged rows that still join changed rows into one window
+    constexpr uint16_t CHART_SPAN = 24 * 60;                                   // Time shown by the chart in minutes, one sample per wake of 60 s
+    constexpr uint16_t CHART_SAMPLES = CHART_SPAN / CHART_COLUMNS;             // Samples averaged into one chart column
+#ifdef DISPLAY_REFRESH_BUDGET
+    constexpr uint16_t REFRESH_BUDGET = DISPLAY_REFRESH_BUDGET;                // Partial refreshes per hour, 3600 refreshes on every change
+#else
+    constexpr uint16_t REFRESH_BUDGET = 12;
+#endif
+    constexpr uint32_t REFRESH_INTERVAL = 3600 / REFRESH_BUDGET;               // Refresh credit in s a partial refresh costs
+    constexpr uint32_t REFRESH_CREDIT_LIMIT = 3 * REFRESH_INTERVAL;            // Refresh credit saved up for a burst of changes
 
-    // CO2 label and value positions (top half, centered)
-    constexpr uint16_t CO2_LABEL_Y = DISPLAY_CENTER_Y - 18;
-    constexpr uint16_t CO2_VALUE_Y = 80;
-
-    // Humidity positions (bottom left quadrant)
-    constexpr uint16_t HUMIDITY_LABEL_Y = DISPLAY_HEIGHT - 18;
-    constexpr uint16_t HUMIDITY_VALUE_Y = DISPLAY_HEIGHT - 70;
-    constexpr uint16_t HUMIDITY_CENTER_X = DISPLAY_CENTER_X / 2;
+    static_assert(MAX_WINDOWS >= WIDGET_COUNT, "Every widget needs a window");
+    static_assert(DISPLAY_WIDTH == Panel::WIDTH_VISIBLE && DISPLAY_HEIGHT == Panel::HEIGHT,
+                  "The layout has to match the panel");
 
-    // Temperature positions (bottom right quadrant)
-    constexpr uint16_t TEMPERATURE_LABEL_Y = DISPLAY_HEIGHT - 18;
-    constexpr uint16_t TEMPERATURE_VALUE_Y = DISPLAY_HEIGHT - 70;
-    constexpr uint16_t TEMPERATURE_CENTER_X = DISPLAY_CENTER_X + (DISPLAY_CENTER_X / 2);
+    // How a raw reading maps to the value shown on the panel
+    struct Quantizer
+    {
+        uint16_t step;       // Raw units per shown digit
+        uint16_t hysteresis; // Raw units the reading has to pass a rounding boundary by before the shown value follows
+        uint16_t deadband;   // Minimum change of the shown value in digits
+    };
 
-    static const uint8_t flash_icon[] = {
-        0x00, 0x80, 0x00, 0x80, 0x01, 0x80, 0x03, 0x80, 0x03, 0x00, 0x07, 0x00, 0x07, 0xf8, 0x0f, 0xf0,
-        0x0f, 0xf0, 0x1f, 0xe0, 0x00, 0xe0, 0x01, 0xc0, 0x01, 0xc0, 0x01, 0x80, 0x01, 0x00, 0x01, 0x00};
+    constexpr Quantizer CO2_QUANTIZER = {1, 0, 5};           // ppm, shown in whole ppm
+    constexpr Quantizer TEMPERATURE_QUANTIZER = {10, 3, 1};  // 1/100 C, shown in 0.1 C
+    constexpr Quantizer HUMIDITY_QUANTIZER = {100, 30, 1};   // 1/100 %, shown in whole percent
 
-    struct DisplayState
+    // When a changed widget is shown without waiting for refresh credit
+    struct RefreshPolicy
     {
-        uint16_t co2 = 0;
-        uint16_t temperature = 0;
-        uint16_t humidity = 0;
-        uint8_t hours = 255;
-        uint8_t minutes = 255;
-        uint8_t batteryPercent = 0; // 0-100, battery percentage
-        bool usbConnected = false;  // USB connection state
-        bool error = false;         // Error State
-    } currentState, previousState;
+        uint16_t urgentChange; // Change of the shown value in raw units that is shown at once, 0 if none is urgent
+        uint16_t maxStaleness; // Longest time in s the widget shows an outdated value
+    };
 
-    bool showClock = false;                           // Flag for showing clock
-    bool fullRefresh = false;                         // Flag for full screen refresh
-    char stringBuffer[16];                            // Shared string buffer to avoid repeated allocations
-    RTC_DATA_ATTR uint16_t displayRefreshCounter = 0; // Counter for partial updates. Preserved in RTC memory
+    constexpr RefreshPolicy REFRESH_POLICIES[WIDGET_COUNT] = {
+        {150, 600},                    // CO2 in ppm
+        {100, 1800},                   // Temperature in 1/100 C
+        {500, 1800},                   // Humidity in 1/100 %
+        {0, 3600},                     // Battery, changes of the USB state are shown at once
+        {0, 60},                       // Clock
+        {0, (CHART_SAMPLES - 1) * 60}, // Chart, shown before the next column is complete
+    };
+    static_assert(REFRESH_BUDGET > 0 && REFRESH_BUDGET <= 3600, "The refresh budget is given in partial refreshes per hour");
+    static_assert(CHART_SAMPLES > 1, "The chart has to wait for less than one column");
 
-    void drawBackground()
+    // Work startDisplayUpdate() leaves for finishDisplayUpdate() while the refresh runs
+    struct PendingUpdate
     {
-        // Draw horizontal line dividing the screen into top and bottom halves
-        display.drawLine(DISPLAY_MARGIN, DISPLAY_CENTER_Y, DISPLAY_WIDTH - DISPLAY_MARGIN, DISPLAY_CENTER_Y, GxEPD_BLACK);
-        // Draw vertical line dividing the bottom half into left and right sections
-        display.drawLine(DISPLAY_CENTER_X, DISPLAY_CENTER_Y, DISPLAY_CENTER_X, DISPLAY_HEIGHT - DISPLAY_MARGIN, GxEPD_BLACK);
-    }
+        bool active = false;      // The controller was woken up and has to be put back to sleep
+        bool refresh = false;     // A refresh was started
+        bool partial = false;
+        bool retained = false;
+        uint32_t toggled = 0;     // Pixels toggled by the refresh
+        uint32_t transferred = 0; // Bytes transferred for the refresh
+    };
+
+    // Measured refresh durations of one waveform mode
+    struct RefreshStats
+    {
+        uint16_t fullCount = 0;
+        uint32_t fullTime = 0; // Sum of all full refresh durations in ms
+        uint16_t partialCount = 0;
+        uint32_t partialTime = 0; // Sum of all partial refresh durations in ms
+    };
 
-    // Helper function to draw centered text at given position
-    void drawCenteredText(const char *text, const GFXfont *font, uint16_t centerX, uint16_t y)
+    DisplayState currentState;                         // State to be shown on this update
+    RTC_DATA_ATTR DisplayState previousState;          // State currently shown on the panel. Preserved in RTC memory
+    RTC_DATA_ATTR uint32_t avoidedRefreshes = 0;       // Wakes whose readings changed without changing the frame. Preserved in RTC memory
+    RTC_DATA_ATTR uint32_t avoidedChanges[WIDGET_COUNT]; // Reading changes per widget that did not change the frame. Preserved in RTC memory
+    RTC_DATA_ATTR Rect previousBounds[WIDGET_COUNT];   // Area covered by each widget on the panel. Preserved in RTC memory
+    bool showClock = false;                            // Flag for showing clock
+    bool fullRefresh = false;                          // Flag for full screen refresh
+    RTC_DATA_ATTR uint32_t ghostingSpent = 0;          // Ghosting budget used by partial updates since the last full refresh. Preserved in RTC memory
+    RTC_DATA_ATTR StaticLayer staticLayer;             // Pre-rendered grid lines and labels. Preserved in RTC memory
+    RTC_DATA_ATTR FrameSnapshot frameSnapshot;         // Compressed copy of the frame on the panel. Preserved in RTC memory
+    uint32_t changedWords[DISPLAY_HEIGHT];             // Changed words per row of the frame, see FrameSnapshot::diffPage()
+    Rect frameWindows[MAX_WINDOWS];                    // Windows to transfer when they do not come from the frame diff
+    uint8_t frameWindowCount = 0;
+    bool diffWindows = false;                          // Windows are taken from changedWords instead of frameWindows
+    uint32_t wakeStart = 0;                            // Time the controller was woken up in us
+    uint32_t lastBusyTime = 0;                         // Duration of the last refresh in ms, measured from the BUSY line, 0 if unknown
+    uint32_t refreshStart = 0;                         // Time the running refresh was started in ms, 0 if the next wait is not for a refresh
+    PendingUpdate pending;                             // Update started and not finished yet
+    Panel::WaveformMode waveformMode = Panel::WAVEFORM_COLD; // Waveform mode of this update
+    RTC_DATA_ATTR RefreshStats refreshStats[Panel::WAVEFORM_COUNT]; // Refresh durations per waveform mode. Preserved in RTC memory
+    RTC_DATA_ATTR uint8_t co2History[CHART_COLUMNS];   // CO2 history of the chart, one value per column in a ring. Preserved in RTC memory
+    RTC_DATA_ATTR uint16_t co2HistoryHead = 0;         // Column of the history written next. Preserved in RTC memory
+    RTC_DATA_ATTR uint32_t co2SampleSum = 0;           // Sum of the samples collected for the next column. Preserved in RTC memory
+    RTC_DATA_ATTR uint8_t co2SampleCount = 0;          // Number of samples collected for the next column. Preserved in RTC memory
+    RTC_DATA_ATTR uint32_t refreshCredit = REFRESH_CREDIT_LIMIT; // Refresh credit in s for partial refreshes. Preserved in RTC memory
+    RTC_DATA_ATTR uint32_t refreshCreditTime = 0;      // Time the refresh credit was last topped up in s. Preserved in RTC memory
+    RTC_DATA_ATTR uint8_t deferredWidgets = 0;         // Widgets whose changes wait for refresh credit. Preserved in RTC memory
+    RTC_DATA_ATTR uint32_t deferredSince[WIDGET_COUNT]; // Time in s each deferred widget has been waiting since. Preserved in RTC memory
+    RTC_DATA_ATTR uint32_t deferredRefreshes = 0;      // Wakes whose refresh waited for refresh credit. Preserved in RTC memory
+    constexpr const char *WAVEFORM_NAMES[Panel::WAVEFORM_COUNT] = {"cold", "normal", "fast"};
+#ifdef DISPLAY_RETAIN_RAM
+    RTC_DATA_ATTR bool controllerRetained = false;     // Controller sleeps in deep sleep mode 1 with valid RAM planes. Preserved in RTC memory
+#endif
+#ifdef DISPLAY_SLEEP_DURING_REFRESH
+    RTC_DATA_ATTR bool refreshInFlight = false;        // The MCU went to deep sleep while the panel was refreshing. Preserved in RTC memory
+#endif
+
+    void waitBusyFunction()
     {
-        display.setFont(font);
-        display.setTextColor(GxEPD_BLACK);
+        setCpuFrequencyMhz(MIN_CPU_FREQ); // Reduce CPU frequency to save power during busy wait
 
-        int16_t tbx, tby;
-        uint16_t tbw, tbh;
-        display.getTextBounds(text, 0, 0, &tbx, &tby, &tbw, &tbh);
+        // Sleep until the panel releases BUSY, the timer only guards against a panel that never finishes.
+        // A refresh is timed from its start, other work may have run on the MCU while the waveform was driven.
+        uint32_t start = refreshStart ? refreshStart : millis();
+        bool finishedEarly = refreshStart && gpio_get_level((gpio_num_t)PIN_BUSY) != PanelConfig::BUSY_LEVEL;
+        refreshStart = 0;
+        bool armed = false; // Wakeup sources are only set up once there is something to sleep through
+        while (gpio_get_level((gpio_num_t)PIN_BUSY) == PanelConfig::BUSY_LEVEL)
+        {
+            uint32_t elapsed = millis() - start;
+            if (elapsed >= DISPLAY_BUSY_TIMEOUT)
+            {
+                Serial.printf("Display busy timeout after %lu ms\n", elapsed);
+                break;
+            }
+            if (!armed)
+            {
+                gpio_wakeup_enable((gpio_num_t)PIN_BUSY, PanelConfig::BUSY_LEVEL ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+                esp_sleep_enable_gpio_wakeup();
+                armed = true;
+            }
+            esp_sleep_enable_timer_wakeup((DISPLAY_BUSY_TIMEOUT - elapsed) * 1000ULL);
+            esp_light_sleep_start();
+        }
+        if (armed)
+        {
+            esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_GPIO);
+            esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+            gpio_wakeup_disable((gpio_num_t)PIN_BUSY);
+        }
+        lastBusyTime = millis() - start;
 
-        uint16_t x = centerX - (tbw / 2) - tbx;
-        display.setCursor(x, y);
-        display.print(text);
+        setCpuFrequencyMhz(MAX_CPU_FREQ); // Restore CPU frequency after busy wait
+        Serial.printf("Display busy for %lu ms (full: %d)\n", lastBusyTime, fullRefresh);
+        if (finishedEarly)
+        {
+            lastBusyTime = 0; // The refresh ended at some point before the wait, its duration is unknown
+        }
     }
 
-    // Helper function to draw text with unit
-    void drawValueWithUnit(const char *valueText, const char *unitText, const GFXfont *valueFont, uint16_t centerX, uint16_t y)
+    void setupDisplay(bool partial)
     {
-        display.setFont(valueFont);
-        display.setTextColor(GxEPD_BLACK);
+        wakeStart = micros();
+        SPI.begin(PIN_SCLK, -1, PIN_MOSI, PIN_CS);
+        panel.init(0, !partial, 2, false);
+        panel.setWaitBusyFunction(waitBusyFunction);
+#ifdef DISPLAY_SPI_DMA
+        if (!panel.beginDma(PIN_SCLK, PIN_MOSI))
+        {
+            Serial.println("SPI DMA setup failed, writing through Arduino SPI");
+        }
+        panel.initController(); // GxEPD2 initialises the controller only in its own write functions, which are bypassed
+        panel.getDmaWaitTime();
+#elif defined(DISPLAY_RETAIN_RAM)
+        if (partial && controllerRetained)
+        {
+            panel.initController(); // Skip the full controller initialisation, the RAM planes still hold the shown frame
+        }
+#endif
+    }
 
-        int16_t tbx, tby;
-        uint16_t tbw, tbh;
-        display.getTextBounds(valueText, 0, 0, &tbx, &tby, &tbw, &tbh);
+#ifdef DISPLAY_SLEEP_DURING_REFRESH
+    // Make sure the refresh left running before the last deep sleep is done, resetting the controller would cut it off.
+    // PIN_BUSY cannot wake the ESP32-C6 from deep sleep, only the LP GPIOs 0 to 7 can, so this is checked on the next wake.
+    bool confirmRefresh()
+    {
+        if (!refreshInFlight)
+        {
+            return false;
+        }
 
-        uint16_t valueX = centerX - (tbw / 2) - tbx;
-        display.setCursor(valueX, y);
-        display.print(valueText);
+        refreshInFlight = false;
+        pinMode(PIN_BUSY, INPUT);
+        if (gpio_get_level((gpio_num_t)PIN_BUSY) == PanelConfig::BUSY_LEVEL)
+        {
+            Serial.println("Refresh from the last wake still running");
+            waitBusyFunction();
+        }
+        else
+        {
+            Serial.println("Refresh from the last wake finished during deep sleep");
+        }
+        return true;
+    }
+#endif
 
-        // Draw unit to the right of the value
-        display.setFont(FONT_UNIT);
-        int16_t tbx2, tby2;
-        uint16_t tbw2, tbh2;
-        display.getTextBounds(unitText, 0, 0, &tbx2, &tby2, &tbw2, &tbh2);
+    // Budget a partial refresh uses up. Toggled pixels leave more residue when the panel is cold.
+    uint32_t getGhostingCost(uint32_t toggled)
+    {
+        int16_t celsius = currentState.temperature / 100; // Below 0 C the panel is as cold as it gets
+        uint16_t weight = 100;
+        if (celsius < GHOSTING_COLD)
+            weight = 200;
+        else if (celsius < GHOSTING_COOL)
+            weight = 150;
+        return GHOSTING_UPDATE_COST + toggled * weight / 100;
+    }
 
-        uint16_t unitX = valueX + tbw + UNIT_SPACING - tbx2;
-        display.setCursor(unitX, y);
-        display.print(unitText);
+    // Pick the waveforms from the measured ambient temperature, the panel's own sensor is the fallback without a valid reading
+    Panel::WaveformMode getWaveformMode()
+    {
+        int16_t celsius = currentState.temperature / 100; // Every temperature below 0 C is cold as well
+        if (currentState.error || celsius < WAVEFORM_COLD_BELOW)
+            return Panel::WAVEFORM_COLD;
+        if (celsius >= WAVEFORM_FAST_FROM && celsius <= WAVEFORM_FAST_UNTIL)
+            return Panel::WAVEFORM_FAST;
+        return Panel::WAVEFORM_NORMAL;
     }
 
-    void drawHumidity()
+    // Add the duration of the refresh that just finished to the statistics of the current waveform mode
+    void recordRefreshTime(bool full)
     {
-        drawCenteredText(LABEL_HUMIDITY, FONT_LABEL, HUMIDITY_CENTER_X, HUMIDITY_LABEL_Y);
-        snprintf(stringBuffer, sizeof(stringBuffer), "%u", currentState.humidity / 100);
-        drawValueWithUnit(stringBuffer, UNIT_PERCENT, FONT_HUMIDITY, HUMIDITY_CENTER_X, HUMIDITY_VALUE_Y);
+        if (lastBusyTime == 0)
+        {
+            Serial.println("Refresh finished before the wait, not recorded");
+            return;
+        }
+
+        RefreshStats &stats = refreshStats[waveformMode];
+        uint16_t count;
+        uint32_t total;
+        if (full)
+        {
+            count = ++stats.fullCount;
+            total = stats.fullTime += lastBusyTime;
+        }
+        else
+        {
+            count = ++stats.partialCount;
+            total = stats.partialTime += lastBusyTime;
+        }
+        Serial.printf("%s %s refresh: %lu ms, average %lu ms over %u\n", WAVEFORM_NAMES[waveformMode], full ? "full" : "partial", lastBusyTime, total / count, count);
     }
 
-    void drawTemperature()
+    // Value to show for a raw reading, in raw units rounded to the shown step. Readings close to the shown
+    // value keep it, so noise around a rounding boundary does not change the frame on every wake.
+    // Temperatures below 0 C are rounded the same way, half a step up and then down to a whole step.
+    int32_t quantize(int32_t raw, int32_t shown, const Quantizer &quantizer, bool exact)
     {
-        drawCenteredText(LABEL_TEMPERATURE, FONT_LABEL, TEMPERATURE_CENTER_X, TEMPERATURE_LABEL_Y);
-        snprintf(stringBuffer, sizeof(stringBuffer), "%d.%d", currentState.temperature / 100, currentState.temperature % 10);
-        drawValueWithUnit(stringBuffer, UNIT_CELSIUS, FONT_TEMPERATURE, TEMPERATURE_CENTER_X, TEMPERATURE_VALUE_Y);
+        int32_t rounded = raw + quantizer.step / 2;
+        int32_t digits = (rounded >= 0 ? rounded : rounded - quantizer.step + 1) / quantizer.step;
+        if (exact)
+        {
+            return digits * quantizer.step;
+        }
+
+        int32_t shownDigits = shown / quantizer.step;
+        int32_t change = abs(digits - shownDigits);
+        int32_t distance = abs(raw - shown);
+        if (change < quantizer.deadband || distance <= quantizer.step / 2 + quantizer.hysteresis)
+        {
+            return shown;
+        }
+        return digits * quantizer.step;
+    }
+
+    // Replace the raw readings by the values to show. A full refresh shows the readings rounded without hysteresis.
+    void quantizeState(bool exact)
+    {
+        currentState.co2 = quantize(currentState.co2, previousState.co2, CO2_QUANTIZER, exact);
+        currentState.temperature = quantize(currentState.temperature, previousState.temperature, TEMPERATURE_QUANTIZER, exact);
+        currentState.humidity = quantize(currentState.humidity, previousState.humidity, HUMIDITY_QUANTIZER, exact);
     }
 
-    void drawClock(const uint8_t hours, const uint8_t minutes)
+    // Add the CO2 reading of this wake to the history, every CHART_SAMPLES readings complete a column of the chart
+    void addHistorySample()
     {
-        snprintf(stringBuffer, sizeof(stringBuffer), "%02d:%02d", hours, minutes);
-        display.setFont(FONT_CLOCK);
-        display.setTextColor(GxEPD_BLACK);
-        display.setCursor(CLOCK_X, CLOCK_Y);
-        display.print(stringBuffer);
+        if (currentState.error || currentState.co2 == 0)
+        {
+            return;
+        }
+
+        co2SampleSum += currentState.co2;
+        if (++co2SampleCount < CHART_SAMPLES)
+        {
+            return;
+        }
+
+        uint16_t value = (co2SampleSum / co2SampleCount + CHART_PPM_STEP / 2) / CHART_PPM_STEP;
+        co2History[co2HistoryHead] = constrain(value, 1, 255);
+        co2HistoryHead = (co2HistoryHead + 1) % CHART_COLUMNS;
+        co2SampleSum = 0;
+        co2SampleCount = 0;
     }
 
-    void drawBatteryIcon()
+    // Bitmask of widgets whose content differs from what is shown on the panel
+    uint8_t getDirtyWidgets()
     {
-        uint16_t x = BATTERY_ICON_X;
-        uint16_t y = BATTERY_ICON_Y;
+        uint8_t dirty = 0;
+        if (currentState.co2 != previousState.co2)
+            dirty |= 1 << WIDGET_CO2;
+        if (currentState.temperature != previousState.temperature)
+            dirty |= 1 << WIDGET_TEMPERATURE;
+        if (currentState.humidity != previousState.humidity)
+            dirty |= 1 << WIDGET_HUMIDITY;
+        if (Renderer::getBatteryLevelWidth(currentState.batteryPercent) != Renderer::getBatteryLevelWidth(previousState.batteryPercent) ||
+            currentState.usbConnected != previousState.usbConnected)
+            dirty |= 1 << WIDGET_BATTERY;
 
-        // Draw a outline of the battery icon
-        display.fillRect(x, y, BATTERY_ICON_WIDTH, BATTERY_ICON_HEIGHT, GxEPD_BLACK);
-        // Draw the battery tip
-        display.fillRect(x + BATTERY_ICON_WIDTH, y + 4, 4, 8, GxEPD_BLACK);
-        // Draw white border inside the battery
-        display.fillRect(x + 1, y + 1, BATTERY_ICON_WIDTH - 2, BATTERY_ICON_HEIGHT - 2, GxEPD_WHITE);
+        // Check clock only if it's enabled and has valid time
+        if (showClock &&
+            currentState.hours != 255 && currentState.minutes != 255 &&
+            (currentState.hours != previousState.hours || currentState.minutes != previousState.minutes))
+            dirty |= 1 << WIDGET_CLOCK;
 
-        // Draw battery level indicator
-        uint16_t batteryLevelWidth = (BATTERY_ICON_WIDTH - 4) * currentState.batteryPercent / 100;
-        display.fillRect(x + 2, y + 2, batteryLevelWidth, BATTERY_ICON_HEIGHT - 4, GxEPD_BLACK);
+        if (currentState.chartHead != previousState.chartHead || currentState.chartOrigin != previousState.chartOrigin)
+            dirty |= 1 << WIDGET_CHART;
 
-        if (currentState.usbConnected)
+        return dirty;
+    }
+
+    // Change of the value shown by a widget in raw units
+    uint16_t getShownChange(uint8_t widget)
+    {
+        switch (widget)
         {
-            // Draw flash_icon
-            display.drawBitmap(x - 16, y, flash_icon, 16, 16, GxEPD_BLACK);
+        case WIDGET_CO2:
+            return abs(static_cast<int32_t>(currentState.co2) - static_cast<int32_t>(previousState.co2));
+        case WIDGET_TEMPERATURE:
+            return abs(static_cast<int32_t>(currentState.temperature) - static_cast<int32_t>(previousState.temperature));
+        case WIDGET_HUMIDITY:
+            return abs(static_cast<int32_t>(currentState.humidity) - static_cast<int32_t>(previousState.humidity));
+        default:
+            return 0;
         }
     }
 
-    void drawBattery()
+    // Decide whether the dirty widgets are shown by a partial refresh now. Each partial refresh spends refresh credit,
+    // which builds up over time up to a limit. Urgent changes and changes that waited too long are shown without
+    // credit. A refresh shows every dirty widget, so changes that waited are coalesced into the next refresh.
+    bool scheduleRefresh(uint8_t dirtyWidgets)
     {
-        drawBatteryIcon();
+        uint32_t now = time(nullptr);
+        uint32_t elapsed = now - refreshCreditTime;
+        refreshCreditTime = now;
+        refreshCredit = elapsed < REFRESH_CREDIT_LIMIT - refreshCredit ? refreshCredit + elapsed : REFRESH_CREDIT_LIMIT;
+
+        bool urgent = currentState.usbConnected != previousState.usbConnected;
+        for (uint8_t widget = 0; widget < WIDGET_COUNT; widget++)
+        {
+            if (!(dirtyWidgets & (1 << widget)))
+                continue;
+            if (!(deferredWidgets & (1 << widget)))
+                deferredSince[widget] = now;
+
+            const RefreshPolicy &policy = REFRESH_POLICIES[widget];
+            if ((policy.urgentChange && getShownChange(widget) >= policy.urgentChange) || now - deferredSince[widget] >= policy.maxStaleness)
+                urgent = true;
+        }
+
+        if (!urgent && refreshCredit < REFRESH_INTERVAL)
+        {
+            deferredWidgets = dirtyWidgets;
+            deferredRefreshes++;
+            Serial.printf("Refresh deferred, %lu so far (credit %lu of %lu s)\n", deferredRefreshes, refreshCredit, REFRESH_INTERVAL);
+            return false;
+        }
+        refreshCredit = refreshCredit > REFRESH_INTERVAL ? refreshCredit - REFRESH_INTERVAL : 0;
+        return true;
     }
 
-    void drawCo2()
+    // Collect the byte aligned windows of all dirty widgets, covering both their old and new area
+    uint8_t getDirtyWindows(uint8_t dirtyWidgets, Rect *windows)
     {
-        drawCenteredText(LABEL_CO2, FONT_LABEL, DISPLAY_CENTER_X, CO2_LABEL_Y);
-        snprintf(stringBuffer, sizeof(stringBuffer), "%u", currentState.co2);
-        drawValueWithUnit(stringBuffer, UNIT_PPM, FONT_CO2, DISPLAY_CENTER_X, CO2_VALUE_Y);
+        uint8_t count = 0;
+        for (uint8_t widget = 0; widget < WIDGET_COUNT; widget++)
+        {
+            if (!(dirtyWidgets & (1 << widget)))
+                continue;
+
+            Rect window = Renderer::getBounds(static_cast<Widget>(widget)).unite(previousBounds[widget]).alignToBytes();
+            if (window.isEmpty())
+                continue;
+
+            // Merge with an already collected window if they overlap to avoid transferring pixels twice
+            bool merged = false;
+            for (uint8_t i = 0; i < count && !merged; i++)
+            {
+                const Rect &other = windows[i];
+                if (window.x < other.x + other.w && other.x < window.x + window.w &&
+                    window.y < other.y + other.h && other.y < window.y + window.h)
+                {
+                    windows[i] = other.unite(window);
+                    merged = true;
+                }
+            }
+            if (!merged)
+            {
+                windows[count++] = window;
+            }
+        }
+        return count;
     }
 
-    void waitBusyFunction()
+    // Turn the changed words of the given rows found by the frame snapshot into windows. Changed rows are grouped
+    // into bands, each band is split into runs of adjacent changed words and each run is shrunk to its rows.
+    uint8_t getChangedWindows(uint16_t firstRow, uint16_t endRow, Rect *windows)
     {
-        setCpuFrequencyMhz(MIN_CPU_FREQ); // Reduce CPU frequency to save power during busy wait
-
-        do
+        constexpr uint16_t WORD_PIXELS = FrameSnapshot::WORD_BYTES * 8;
+        uint8_t count = 0;
+        uint16_t row = firstRow;
+        while (row < endRow)
         {
-            if (fullRefresh)
+            if (!changedWords[row])
             {
-                yield();
+                row++;
+                continue;
             }
-            else
+
+            uint16_t bandStart = row;
+            uint16_t bandEnd = row;
+            uint32_t columns = 0;
+            for (; row < endRow && row <= bandEnd + WINDOW_ROW_GAP; row++)
             {
-                esp_sleep_enable_timer_wakeup(DISPLAY_BUSY_SLEEP * 1000);
-                esp_light_sleep_start();
+                if (changedWords[row])
+                {
+                    bandEnd = row;
+                    columns |= changedWords[row];
+                }
             }
 
-        } while (gpio_get_level((gpio_num_t)PIN_BUSY)); // Wait for display to finish updating
+            while (columns)
+            {
+                uint8_t first = __builtin_ctzl(columns);
+                uint8_t length = __builtin_ctzl(~(columns >> first)); // columns >> first always has a zero bit above the run
+                uint32_t run = (length >= 32 ? ~0UL : (1UL << length) - 1) << first;
+                columns &= ~run;
 
-        setCpuFrequencyMhz(MAX_CPU_FREQ); // Restore CPU frequency after busy wait
+                uint16_t top = bandEnd;
+                uint16_t bottom = bandStart;
+                for (uint16_t r = bandStart; r <= bandEnd; r++)
+                {
+                    if (changedWords[r] & run)
+                    {
+                        top = min(top, r);
+                        bottom = max(bottom, r);
+                    }
+                }
+
+                Rect window;
+                window.x = first * WORD_PIXELS;
+                window.y = top;
+                window.w = min<int16_t>((first + length) * WORD_PIXELS, DISPLAY_WIDTH) - window.x;
+                window.h = bottom - top + 1;
+                if (count < MAX_WINDOWS)
+                {
+                    windows[count++] = window;
+                }
+                else
+                {
+                    windows[MAX_WINDOWS - 1] = windows[MAX_WINDOWS - 1].unite(window);
+                }
+            }
+        }
+        return count;
     }
 
-    void setupDisplay(bool partial)
+#ifdef DISPLAY_DUMP_FRAME
+    // Print the rows of the current page as plain PBM, the header goes before the first page
+    void dumpPage()
     {
-        SPI.begin(PIN_SCLK, -1, PIN_MOSI, PIN_CS);
-        display.init(0, !partial, 2, false);
-        display.epd2.setWaitBusyFunction(waitBusyFunction);
-        display.setRotation(0);
+        if (display.getPageTop() == 0)
+        {
+            Serial.printf("P1\n%u %u\n", DISPLAY_WIDTH, DISPLAY_HEIGHT);
+        }
+
+        char line[DISPLAY_WIDTH + 1];
+        line[DISPLAY_WIDTH] = '\0';
+        for (uint16_t row = 0; row < display.getPageRows(); row++)
+        {
+            const uint8_t *src = &display.getBuffer()[row * display.getStride()];
+            for (uint16_t x = 0; x < DISPLAY_WIDTH; x++)
+            {
+                line[x] = (src[x / 8] & (0x80 >> (x & 7))) ? '0' : '1'; // PBM uses 1 for black
+            }
+            Serial.println(line);
+        }
     }
+#endif
 
-    bool getStateChanged()
+#ifdef DISPLAY_BENCHMARK
+    // Print the time of fills, bitmaps and glyphs drawn through Adafruit GFX into a whole frame
+    template <typename Buffer>
+    void benchmarkPrimitives(Buffer &buffer, const char *name)
     {
-        // Check basic sensor values (early return for efficiency)
-        if (currentState.co2 != previousState.co2 ||
-            currentState.temperature != previousState.temperature ||
-            currentState.humidity != previousState.humidity ||
-            currentState.batteryPercent != previousState.batteryPercent)
+        constexpr uint16_t ITERATIONS = 200;
+        uint8_t bitmap[32 * 32 / 8];
+        for (uint8_t i = 0; i < sizeof(bitmap); i++)
         {
-            return true;
+            bitmap[i] = i * 37;
         }
 
-        // Check clock only if it's enabled and has valid time
-        if (showClock &&
-            currentState.hours != 255 && currentState.minutes != 255 &&
-            (currentState.hours != previousState.hours || currentState.minutes != previousState.minutes))
+        uint32_t start = micros();
+        for (uint16_t i = 0; i < ITERATIONS; i++)
         {
-            return true;
+            buffer.fillRect(i % 300, i % 200, 97, 61, i & 1 ? GxEPD_BLACK : GxEPD_WHITE);
         }
+        uint32_t fillTime = micros() - start;
 
-        return false;
+        start = micros();
+        for (uint16_t i = 0; i < ITERATIONS; i++)
+        {
+            buffer.drawBitmap(i % 360, i % 260, bitmap, 32, 32, GxEPD_BLACK);
+        }
+        uint32_t bitmapTime = micros() - start;
+
+        buffer.setFont(&FreeMonoBold24pt7b);
+        buffer.setTextColor(GxEPD_BLACK);
+        start = micros();
+        for (uint16_t i = 0; i < ITERATIONS; i++)
+        {
+            buffer.setCursor(i % 200, 50 + i % 200);
+            buffer.print("12.34");
+        }
+        uint32_t glyphTime = micros() - start;
+
+        // Seven segment digits of about the height of the 24pt digits
+        start = micros();
+        for (uint16_t i = 0; i < ITERATIONS; i++)
+        {
+            drawSegmentText(buffer, &SegmentFont<30>::FONT, "12.34", i % 200, 50 + i % 200, GxEPD_BLACK);
+        }
+        uint32_t segmentTime = micros() - start;
+
+        Serial.printf("%s: fillRect %lu us, drawBitmap %lu us, 5 glyphs %lu us, 5 segment digits %lu us per call\n",
+                      name, fillTime / ITERATIONS, bitmapTime / ITERATIONS, glyphTime / ITERATIONS,
+                      segmentTime / ITERATIONS);
+    }
+#endif
+
+    // Windows to transfer that overlap the current page, clipped to it
+    uint8_t getPageWindows(Rect *windows)
+    {
+        int16_t top = display.getPageTop();
+        int16_t end = top + display.getPageRows();
+        if (diffWindows)
+        {
+            return getChangedWindows(top, end, windows);
+        }
+
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < frameWindowCount; i++)
+        {
+            Rect window = frameWindows[i];
+            int16_t bottom = min<int16_t>(window.y + window.h, end);
+            window.y = max<int16_t>(window.y, top);
+            window.h = bottom - window.y;
+            if (!window.isEmpty())
+            {
+                windows[count++] = window;
+            }
+        }
+        return count;
+    }
+
+    // Transfer the windows of the current page to the controller, returns the number of bytes sent.
+    // The second pass after the refresh brings the previous-image plane in sync for the next update.
+    uint32_t transferPage(bool full, bool retained, bool secondPass)
+    {
+        Rect windows[MAX_WINDOWS];
+        uint8_t count = getPageWindows(windows);
+        const uint8_t *page = display.getBuffer();
+        uint16_t stride = display.getStride();
+        int16_t top = display.getPageTop();
+#ifndef DISPLAY_SPI_DMA
+        uint16_t rows = display.getPageRows();
+#endif
+        uint32_t transferred = 0;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            const Rect &r = windows[i];
+#ifdef DISPLAY_SPI_DMA
+            // The new-data plane first, the previous-image plane after the refresh. A full refresh ignores the previous plane.
+            // A retained full refresh has no pass after it, the previous-image plane is written up front.
+            if (full && retained)
+                panel.writePlane(Panel::PLANE_PREVIOUS, &page[(r.y - top) * stride], stride, r.x, r.y, r.w, r.h);
+            panel.writePlane(secondPass ? Panel::PLANE_PREVIOUS : Panel::PLANE_NEW, &page[(r.y - top) * stride], stride, r.x, r.y, r.w, r.h);
+#else
+            if (full)
+            {
+                // Full pages are whole rows, the page buffer can be passed as the image
+                if (secondPass)
+                    panel.writeImageAgain(&page[(r.y - top) * stride], r.x, r.y, r.w, r.h);
+                else
+                    panel.writeImageForFullRefresh(&page[(r.y - top) * stride], r.x, r.y, r.w, r.h);
+            }
+#ifdef DISPLAY_PANEL_SSD16XX
+            else if (retained)
+            {
+                panel.writePlane(Panel::PLANE_NEW, &page[(r.y - top) * stride], stride, r.x, r.y, r.w, r.h);
+            }
+#endif
+            else if (secondPass)
+            {
+                panel.writeImagePartAgain(page, r.x, r.y - top, DISPLAY_WIDTH, rows, r.x, r.y, r.w, r.h);
+            }
+            else
+            {
+                panel.writeImagePart(page, r.x, r.y - top, DISPLAY_WIDTH, rows, r.x, r.y, r.w, r.h);
+            }
+#endif
+            transferred += r.w / 8 * r.h;
+        }
+        return transferred;
     }
 };
 
-void updateDisplay(bool partial)
+void startDisplayUpdate(bool partial)
 {
     Serial.printf("Updating display (partial: %d)\n", partial);
-    // Force full refresh after a certain number of partial updates
-    if (displayRefreshCounter++ >= DISPLAY_FULL_REFRESH_INTERVAL)
+#ifdef DISPLAY_SLEEP_DURING_REFRESH
+    bool controllerAwake = confirmRefresh(); // The controller was left powered off but not in deep sleep
+#endif
+    // Force full refresh once partial updates have used up the ghosting budget
+    if (ghostingSpent >= GHOSTING_BUDGET)
     {
         partial = false;
-        displayRefreshCounter = 0;
     }
 
-    // Check if any values have changed since the last update
-    bool hasChanges = getStateChanged();
+    // A new history column only adds its bar and moves the gap. Full refreshes redraw the chart with the oldest column on the left.
+    addHistorySample();
+    currentState.chartHead = co2HistoryHead;
+    currentState.chartOrigin = partial ? previousState.chartOrigin : co2HistoryHead;
+
+    // Check which widgets have changed since the last update, comparing what would be drawn
+    uint8_t changedReadings = getDirtyWidgets();
+    if (currentState.batteryPercent != previousState.batteryPercent)
+        changedReadings |= 1 << WIDGET_BATTERY;
+    quantizeState(!partial);
+    uint8_t dirtyWidgets = getDirtyWidgets();
+    bool layoutChanged = currentState.error != previousState.error; // Switching to/from the error screen redraws everything
 
-    if (!partial || hasChanges)
+    uint8_t avoided = changedReadings & ~dirtyWidgets;
+    for (uint8_t widget = 0; widget < WIDGET_COUNT; widget++)
+    {
+        if (avoided & (1 << widget))
+            avoidedChanges[widget]++;
+    }
+    if (partial && !dirtyWidgets && !layoutChanged && avoided)
+    {
+        avoidedRefreshes++;
+        Serial.printf("Refresh avoided, %lu so far (co2 %lu, temperature %lu, humidity %lu, battery %lu)\n", avoidedRefreshes,
+                      avoidedChanges[WIDGET_CO2], avoidedChanges[WIDGET_TEMPERATURE], avoidedChanges[WIDGET_HUMIDITY], avoidedChanges[WIDGET_BATTERY]);
+    }
+
+    // Full refreshes and switching the screen never wait for refresh credit
+    if (partial && dirtyWidgets && !layoutChanged && !scheduleRefresh(dirtyWidgets))
+    {
+        currentState = previousState; // The panel keeps showing its state, the changes stay pending
+        dirtyWidgets = 0;
+    }
+
+    if (!partial || dirtyWidgets || layoutChanged)
     {
         setupDisplay(partial);
-        display.setFullWindow();
-        display.fillScreen(GxEPD_WHITE);
-        if (currentState.error)
+        waveformMode = getWaveformMode();
+        panel.setWaveformMode(waveformMode, currentState.temperature);
+
+        bool retained = false;
+#ifdef DISPLAY_RETAIN_RAM
+        retained = partial && controllerRetained; // The new-data plane alone is written, the controller keeps the previous image
+#endif
+#ifdef DISPLAY_SLEEP_DURING_REFRESH
+        retained = true; // Nothing is written after the refresh, full refreshes write the previous-image plane with the new one
+#endif
+        Renderer::setChartHistory(co2History);
+        if (!Renderer::beginFrame(display, staticLayer, currentState, showClock))
         {
-            drawCenteredText("SENSOR", FONT_CO2, DISPLAY_CENTER_X, DISPLAY_CENTER_Y - 50);
-            drawCenteredText("ERROR", FONT_CO2, DISPLAY_CENTER_X, DISPLAY_CENTER_Y);
+            Serial.println("Static layer exceeds its budget, drawing it on every update");
         }
-        else
+        bool snapshotValid = frameSnapshot.isValid();
+
+        // Render the frame page by page. Each page is diffed against the snapshot, its changed windows
+        // are transferred and it is encoded into the new snapshot before the next page is drawn.
+        uint32_t toggled = 0;
+        uint32_t transferred = 0;
+        uint32_t renderTime = 0;
+        uint32_t transferTime = 0;
+        frameSnapshot.begin(display.getStride(), DISPLAY_HEIGHT, SNAPSHOT_SCRATCH);
+        for (uint16_t page = 0; page < display.getPageCount(); page++)
         {
-            drawBackground();
+            uint32_t start = micros();
+            display.setPage(page);
+            Renderer::renderPage();
+#ifdef DISPLAY_DUMP_FRAME
+            dumpPage();
+#endif
+            uint32_t pageToggled = frameSnapshot.diffPage(display.getBuffer(), display.getPageRows(), &changedWords[display.getPageTop()]);
+            renderTime += micros() - start;
+
+            if (page == 0)
+            {
+                // The widget bounds are complete once the first page is drawn
+                diffWindows = partial && snapshotValid;
+                frameWindowCount = 0;
+                if (!partial || (!snapshotValid && layoutChanged))
+                {
+                    frameWindows[frameWindowCount].x = 0;
+                    frameWindows[frameWindowCount].y = 0;
+                    frameWindows[frameWindowCount].w = DISPLAY_WIDTH;
+                    frameWindows[frameWindowCount].h = DISPLAY_HEIGHT;
+                    frameWindowCount++;
+                }
+                else if (!snapshotValid)
+                {
+                    frameWindowCount = getDirtyWindows(dirtyWidgets, frameWindows);
+                }
+            }
+
+            start = micros();
+            uint32_t pageTransferred = transferPage(!partial, retained, false);
+            transferTime += micros() - start;
+            transferred += pageTransferred;
+            toggled += diffWindows ? pageToggled : pageTransferred * 8; // Without the diff every transferred pixel may have toggled
 
-            // Draw all elements if they have valid values
-            drawCo2();
-            drawTemperature();
-            drawHumidity();
+            frameSnapshot.storePage(display.getBuffer(), display.getPageRows());
+        }
+        Serial.printf("Rendered %u pages of %u rows (%lu bytes) in %lu us, transferred %lu of %d bytes in %lu us (%lu kB/s)\n",
+                      display.getPageCount(), display.getPageHeight(), display.getBufferSize(), renderTime,
+                      transferred, DISPLAY_WIDTH / 8 * DISPLAY_HEIGHT, transferTime, transferTime ? transferred * 1000 / transferTime : 0);
+        if (diffWindows)
+        {
+            Serial.printf("Frame diff: %lu pixels toggled\n", toggled);
         }
 
-        if (showClock)
+        if (Renderer::endFrame())
         {
-            drawClock(currentState.hours, currentState.minutes);
+            Serial.printf("Static layer captured (%u bytes)\n", staticLayer.size());
+        }
+        if (!frameSnapshot.commit())
+        {
+            Serial.println("Frame snapshot exceeds its budget, falling back to widget windows");
+        }
+
+        pending.active = true;
+        pending.refresh = transferred > 0;
+        pending.partial = partial;
+        pending.retained = retained;
+        pending.toggled = toggled;
+        pending.transferred = transferred;
+        if (pending.refresh)
+        {
+#ifdef DISPLAY_SPI_DMA
+            // Awake time up to the refresh, the CPU idles while it is blocked on DMA
+            Serial.printf("Display ready for refresh after %lu us, %lu us of it blocked on DMA\n", micros() - wakeStart, panel.getDmaWaitTime());
+#else
+            Serial.printf("Display ready for refresh after %lu us\n", micros() - wakeStart);
+#endif
+            refreshStart = millis();
+            if (!partial)
+            {
+                fullRefresh = true; // Set flag for full screen refresh
+                panel.startRefreshFull();
+            }
+            else
+            {
+#ifdef DISPLAY_SLEEP_DURING_REFRESH
+                panel.startRefreshPartial(true);
+#else
+                panel.startRefreshPartial();
+#endif
+            }
+        }
+    }
+#ifdef DISPLAY_SLEEP_DURING_REFRESH
+    else if (controllerAwake)
+    {
+        // Nothing to show, the controller still goes to deep sleep
+        setupDisplay(true);
+        panel.sleepRetained();
+#ifdef DISPLAY_SPI_DMA
+        panel.endDma();
+#endif
+    }
+#endif
+}
+
+void finishDisplayUpdate()
+{
+    if (pending.active)
+    {
+        pending.active = false;
+        if (pending.refresh)
+        {
+#ifdef DISPLAY_SLEEP_DURING_REFRESH
+            // The controller drives the waveform and powers off on its own while the MCU is in deep sleep
+            panel.releaseRefresh();
+            refreshInFlight = true;
+            Serial.println("Refresh left running");
+#else
+            lastBusyTime = 0;
+            panel.finishRefresh();
+            recordRefreshTime(!pending.partial);
+#endif
+            refreshStart = 0;
+            if (!pending.partial)
+            {
+                fullRefresh = false; // Reset flag after display update
+                ghostingSpent = 0;
+            }
+            else
+            {
+                ghostingSpent += getGhostingCost(pending.toggled);
+                Serial.printf("Ghosting budget: %lu of %lu used\n", ghostingSpent, GHOSTING_BUDGET);
+            }
+
+            if (pending.retained)
+            {
+                // In display mode 2 the controller takes the new-data plane over as previous image.
+                // A retained full refresh wrote the previous image before the refresh.
+                Serial.printf("Retained refresh, %lu bytes saved\n", pending.transferred);
+            }
+            else
+            {
+                // Send the same windows again, a single page still holds the whole frame
+                for (uint16_t page = 0; page < display.getPageCount(); page++)
+                {
+                    if (display.getPageCount() > 1)
+                    {
+                        display.setPage(page);
+                        Renderer::renderPage();
+                    }
+                    transferPage(!pending.partial, false, true);
+                }
+            }
         }
 
-        // Always draw battery icon
-        drawBattery();
-        fullRefresh = !partial; // Set flag for full screen refresh
-        display.display(partial);
-        fullRefresh = false; // Reset flag after display update
         previousState = currentState;
-        display.hibernate();
+        deferredWidgets = 0;
+        for (uint8_t widget = 0; widget < WIDGET_COUNT; widget++)
+        {
+            previousBounds[widget] = Renderer::getBounds(static_cast<Widget>(widget));
+        }
+#ifdef DISPLAY_SLEEP_DURING_REFRESH
+        if (!refreshInFlight)
+        {
+            panel.sleepRetained(); // A running refresh is put to sleep on the next wake
+        }
+        controllerRetained = true;
+#elif defined(DISPLAY_RETAIN_RAM)
+        panel.sleepRetained();
+        controllerRetained = true;
+#elif defined(DISPLAY_SPI_DMA)
+        panel.sleepRetained(); // Same deep sleep mode as hibernate(), which would write through Arduino SPI
+#else
+        panel.hibernate();
+#endif
+#ifdef DISPLAY_SPI_DMA
+        panel.endDma();
+#endif
     }
     Serial.printf("Display update complete\n");
 }
 
+void updateDisplay(bool partial)
+{
+    startDisplayUpdate(partial);
+    finishDisplayUpdate();
+}
+
+#ifdef DISPLAY_BENCHMARK
+void runDisplayBenchmark()
+{
+    constexpr uint16_t ITERATIONS = 200;
+    constexpr uint16_t RANDOM_STATES = 1000;
+    constexpr const char *WIDGET_NAMES[WIDGET_COUNT] = {"co2", "temperature", "humidity", "battery", "clock", "chart"};
+    Serial.printf("Panel: %s, %ux%u\n", PanelConfig::NAME, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+
+    DisplayState state;
+    state.co2 = 1888;
+    state.temperature = 2388;
+    state.humidity = 8888;
+    state.hours = 12;
+    state.minutes = 34;
+    uint8_t history[CHART_COLUMNS];
+    for (uint16_t i = 0; i < CHART_COLUMNS; i++)
+    {
+        history[i] = random(400, 2001) / CHART_PPM_STEP;
+    }
+    Renderer::setChartHistory(history);
+    Renderer::beginFrame(display, staticLayer, state, true);
+    Serial.printf("Display benchmark (%d iterations, %d MHz)\n", ITERATIONS, getCpuFrequencyMhz());
+    for (uint8_t widget = WIDGET_CO2; widget <= WIDGET_HUMIDITY; widget++)
+    {
+        uint32_t elapsed[2];
+        for (uint8_t blitter = 0; blitter < 2; blitter++)
+        {
+            Renderer::setGlyphBlitter(blitter);
+            display.fillScreen(GxEPD_WHITE);
+            uint32_t start = micros();
+            for (uint16_t i = 0; i < ITERATIONS; i++)
+            {
+                Renderer::drawWidget(static_cast<Widget>(widget));
+            }
+            elapsed[blitter] = micros() - start;
+        }
+        Serial.printf("%s: GFX %lu us, glyph blitter %lu us per call\n", WIDGET_NAMES[widget], elapsed[0] / ITERATIONS, elapsed[1] / ITERATIONS);
+    }
+    Renderer::setGlyphBlitter(true);
+
+    // Adafruit GFX primitives with the runtime rotation of GFXcanvas1 against the compile time one of the frame buffer
+    {
+        GFXcanvas1 canvas(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+        DisplayBuffer frame(DISPLAY_HEIGHT);
+        canvas.setRotation(DISPLAY_ROTATION);
+        benchmarkPrimitives(canvas, "GFXcanvas1");
+        benchmarkPrimitives(frame, "FrameBuffer");
+        Serial.printf("Flash: 24pt font %u bytes, 30 px segment font %u bytes\n",
+                      sizeof(FreeMonoBold24pt7bBitmaps) + sizeof(FreeMonoBold24pt7bGlyphs),
+                      sizeof(SegmentFont<30>::GLYPHS));
+    }
+
+    // Whole frames and single widgets over random states, all pages of the frame buffer
+    uint32_t frameTime = 0;
+    uint32_t widgetTime[WIDGET_COUNT] = {};
+    for (uint16_t i = 0; i < RANDOM_STATES; i++)
+    {
+        state.co2 = random(400, 5001);
+        state.temperature = random(-1000, 4000);
+        state.humidity = random(0, 10001);
+        state.hours = random(0, 24);
+        state.minutes = random(0, 60);
+        state.batteryPercent = random(0, 101);
+        state.usbConnected = random(0, 2);
+        Renderer::beginFrame(display, staticLayer, state, true);
+
+        uint32_t start = micros();
+        for (uint16_t page = 0; page < display.getPageCount(); page++)
+        {
+            display.setPage(page);
+            Renderer::renderPage();
+        }
+        frameTime += micros() - start;
+
+        for (uint8_t widget = 0; widget < WIDGET_COUNT; widget++)
+        {
+            start = micros();
+            for (uint16_t page = 0; page < display.getPageCount(); page++)
+            {
+                display.setPage(page);
+                Renderer::drawWidget(static_cast<Widget>(widget));
+            }
+            widgetTime[widget] += micros() - start;
+        }
+    }
+    Serial.printf("Frame: %lu us per random state\n", frameTime / RANDOM_STATES);
+    for (uint8_t widget = 0; widget < WIDGET_COUNT; widget++)
+    {
+        Serial.printf("%s: %lu us per random state\n", WIDGET_NAMES[widget], widgetTime[widget] / RANDOM_STATES);
+    }
+
+    // Frame buffer size against the time to render, diff and encode a whole frame per page height.
+    // The transfer time at the configured page height is logged by every update.
+    constexpr uint16_t FRAME_ITERATIONS = 20;
+    constexpr uint16_t PAGE_HEIGHTS[] = {DISPLAY_HEIGHT, 150, 100, 50, 25, 10};
+    uint8_t *scratch = new uint8_t[FrameSnapshot::BUDGET];
+    for (uint16_t pageHeight : PAGE_HEIGHTS)
+    {
+        if (!display.setPageHeight(pageHeight))
+        {
+            continue; // Larger than the allocated frame buffer
+        }
+
+        uint32_t start = micros();
+        for (uint16_t i = 0; i < FRAME_ITERATIONS; i++)
+        {
+            frameSnapshot.begin(display.getStride(), DISPLAY_HEIGHT, scratch);
+            for (uint16_t page = 0; page < display.getPageCount(); page++)
+            {
+                display.setPage(page);
+                Renderer::renderPage();
+                frameSnapshot.diffPage(display.getBuffer(), display.getPageRows(), &changedWords[display.getPageTop()]);
+                frameSnapshot.storePage(display.getBuffer(), display.getPageRows());
+            }
+        }
+        Serial.printf("Page height %u: %u bytes, %lu us per frame\n", pageHeight, display.getStride() * pageHeight, (micros() - start) / FRAME_ITERATIONS);
+    }
+    display.setPageHeight(PAGE_HEIGHT);
+    delete[] scratch;
+
+    // Transfer of a whole frame into the panel RAM, without a refresh
+    setupDisplay(false);
+    uint32_t transferred = 0;
+    uint32_t transferTime = 0;
+    frameWindows[0] = {0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT};
+    frameWindowCount = 1;
+    diffWindows = false;
+    for (uint16_t page = 0; page < display.getPageCount(); page++)
+    {
+        display.setPage(page);
+        Renderer::renderPage();
+        uint32_t start = micros();
+        transferred += transferPage(true, false, false);
+        transferTime += micros() - start;
+    }
+#ifdef DISPLAY_SPI_DMA
+    Serial.printf("Frame transfer: %lu bytes in %lu us (%lu kB/s), %lu us blocked on DMA\n", transferred, transferTime,
+                  transferred * 1000 / transferTime, panel.getDmaWaitTime());
+    panel.sleepRetained();
+    panel.endDma();
+#else
+    Serial.printf("Frame transfer: %lu bytes in %lu us (%lu kB/s)\n", transferred, transferTime, transferred * 1000 / transferTime);
+    panel.hibernate();
+#endif
+    ghostingSpent = GHOSTING_BUDGET; // The panel RAM no longer holds the shown frame, the next update has to be a full one
+#ifdef DISPLAY_RETAIN_RAM
+    controllerRetained = false;
+#endif
+}
+#endif
+
 void setErrorState(bool error)
 {
     currentState.error = error;
@@ -299,7 +1063,7 @@ void setCo2Value(const uint16_t co2)
     currentState.co2 = co2;
 }
 
-void setTemperatureValue(const uint16_t temperature)
+void setTemperatureValue(const int16_t temperature)
 {
     currentState.temperature = temperature;
 }
@@ -3,14 +3,20 @@
 
 void enableClock(bool show);
 void updateDisplay(bool partial);
+void startDisplayUpdate(bool partial); // Transfer the frame and start the refresh without waiting for the panel
+void finishDisplayUpdate();            // Wait for the refresh started by startDisplayUpdate() and put the panel to sleep
 
 // Functions to set individual values
 void setErrorState(bool error);
 void setCo2Value(uint16_t co2);
-void setTemperatureValue(uint16_t temperature);
+void setTemperatureValue(int16_t temperature);
 void setHumidityValue(uint16_t humidity);
 void setTimeValue(uint8_t hours, uint8_t minutes);
 void setBatteryPercent(uint8_t percent); // 0-100%, battery percentage
 void setUSBConnected(bool connected); // Set USB connection state
 
+#ifdef DISPLAY_BENCHMARK
+void runDisplayBenchmark(); // Print render timings of the display widgets
+#endif
+
 
@@ -0,0 +1,280 @@
+#pragma once
+#include <Adafruit_GFX.h>
+#include <string.h>
+
+// 1 bit frame buffer (MSB first, 1 = white) that holds one horizontal page of the panel at a time.
+// The frame is drawn once per page with frame coordinates, pixels outside the current page are
+// dropped. With a single page as high as the panel it behaves like GFXcanvas1.
+// Panel geometry and rotation are template parameters, so pixels, fills and lines compile to plain
+// byte operations without the runtime rotation switch of Adafruit GFX. Pages are rows of the panel,
+// with rotation 1 and 3 they run across the frame vertically.
+template <uint16_t PANEL_WIDTH, uint16_t PANEL_HEIGHT, uint8_t ROTATION>
+class FrameBuffer : public Adafruit_GFX
+{
+public:
+    static_assert(ROTATION < 4, "Rotation is given in quarter turns");
+    static constexpr uint16_t STRIDE = (PANEL_WIDTH + 7) / 8;                           // Bytes per row
+    static constexpr uint16_t FRAME_WIDTH = ROTATION & 1 ? PANEL_HEIGHT : PANEL_WIDTH;  // Width seen by the drawing code
+    static constexpr uint16_t FRAME_HEIGHT = ROTATION & 1 ? PANEL_WIDTH : PANEL_HEIGHT; // Height seen by the drawing code
+
+    explicit FrameBuffer(uint16_t pageHeight)
+        : Adafruit_GFX(FRAME_WIDTH, FRAME_HEIGHT), mCapacity(pageHeight < PANEL_HEIGHT ? pageHeight : PANEL_HEIGHT),
+          mPageHeight(mCapacity), mPageTop(0), mPageRows(mCapacity)
+    {
+        rotation = ROTATION;
+        mBuffer = static_cast<uint8_t *>(malloc(STRIDE * mCapacity));
+    }
+
+    ~FrameBuffer()
+    {
+        free(mBuffer);
+    }
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override
+    {
+        setPixel(x, y, color);
+    }
+
+    void writePixel(int16_t x, int16_t y, uint16_t color) override
+    {
+        setPixel(x, y, color);
+    }
+
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override
+    {
+        fill(x, y, w, h, color);
+    }
+
+    void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override
+    {
+        fill(x, y, w, h, color);
+    }
+
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override
+    {
+        fill(x, y, w, 1, color);
+    }
+
+    void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override
+    {
+        fill(x, y, w, 1, color);
+    }
+
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override
+    {
+        fill(x, y, 1, h, color);
+    }
+
+    void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override
+    {
+        fill(x, y, 1, h, color);
+    }
+
+    // Fill the current page
+    void fillScreen(uint16_t color) override
+    {
+        if (mBuffer != nullptr)
+        {
+            memset(mBuffer, color ? 0xFF : 0x00, STRIDE * mPageRows);
+        }
+    }
+
+    // The rotation is fixed by the template parameter
+    void setRotation(uint8_t) override
+    {
+    }
+
+    // Rows per page, at most the page height given to the constructor
+    bool setPageHeight(uint16_t pageHeight)
+    {
+        if (pageHeight == 0 || pageHeight > mCapacity)
+        {
+            return false;
+        }
+        mPageHeight = pageHeight;
+        setPage(0);
+        return true;
+    }
+
+    uint16_t getPageHeight() const
+    {
+        return mPageHeight;
+    }
+
+    uint16_t getPageCount() const
+    {
+        return (PANEL_HEIGHT + mPageHeight - 1) / mPageHeight;
+    }
+
+    // Select the page drawn into, 0 is the top one
+    void setPage(uint16_t page)
+    {
+        mPageTop = page * mPageHeight;
+        mPageRows = mPageHeight < PANEL_HEIGHT - mPageTop ? mPageHeight : PANEL_HEIGHT - mPageTop;
+    }
+
+    // First panel row of the current page
+    int16_t getPageTop() const
+    {
+        return mPageTop;
+    }
+
+    // Rows of the current page, the last page may be shorter
+    uint16_t getPageRows() const
+    {
+        return mPageRows;
+    }
+
+    // True if the frame rows y ... y + h - 1 may overlap the current page
+    bool intersectsPage(int16_t y, int16_t h) const
+    {
+        if (ROTATION & 1)
+            return true; // Frame rows are panel columns, every page holds a part of them
+        if (ROTATION == 2)
+            y = PANEL_HEIGHT - y - h;
+        return y < mPageTop + mPageRows && y + h > mPageTop;
+    }
+
+    uint16_t getStride() const
+    {
+        return STRIDE;
+    }
+
+    // First row of the current page
+    uint8_t *getBuffer() const
+    {
+        return mBuffer;
+    }
+
+    // Allocated bytes
+    uint32_t getBufferSize() const
+    {
+        return static_cast<uint32_t>(STRIDE) * mCapacity;
+    }
+
+private:
+    uint8_t *mBuffer;
+    uint16_t mCapacity;   // Rows allocated
+    uint16_t mPageHeight; // Rows per page
+    int16_t mPageTop;
+    uint16_t mPageRows;
+
+    void setPixel(int16_t x, int16_t y, uint16_t color)
+    {
+        if (x < 0 || x >= FRAME_WIDTH || y < 0 || y >= FRAME_HEIGHT)
+        {
+            return;
+        }
+
+        int16_t t;
+        switch (ROTATION) // Resolved at compile time
+        {
+        case 1:
+            t = x;
+            x = PANEL_WIDTH - 1 - y;
+            y = t;
+            break;
+        case 2:
+            x = PANEL_WIDTH - 1 - x;
+            y = PANEL_HEIGHT - 1 - y;
+            break;
+        case 3:
+            t = x;
+            x = y;
+            y = PANEL_HEIGHT - 1 - t;
+            break;
+        }
+
+        y -= mPageTop;
+        if (mBuffer == nullptr || y < 0 || y >= mPageRows)
+        {
+            return;
+        }
+
+        uint8_t *ptr = &mBuffer[y * STRIDE + x / 8];
+        if (color)
+            *ptr |= 0x80 >> (x & 7);
+        else
+            *ptr &= ~(0x80 >> (x & 7));
+    }
+
+    // Fill a rectangle given in frame coordinates, whole bytes are set at once
+    void fill(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+    {
+        if (w < 0)
+        {
+            x += w + 1;
+            w = -w;
+        }
+        if (h < 0)
+        {
+            y += h + 1;
+            h = -h;
+        }
+
+        // Clip to the frame, then turn into panel coordinates
+        int16_t x0 = x < 0 ? 0 : x;
+        int16_t y0 = y < 0 ? 0 : y;
+        int16_t x1 = x + w > FRAME_WIDTH ? FRAME_WIDTH : x + w;
+        int16_t y1 = y + h > FRAME_HEIGHT ? FRAME_HEIGHT : y + h;
+        if (mBuffer == nullptr || x0 >= x1 || y0 >= y1)
+        {
+            return;
+        }
+
+        int16_t left, top, right, bottom; // Panel rectangle, right and bottom exclusive
+        switch (ROTATION)
+        {
+        case 0:
+            left = x0, top = y0, right = x1, bottom = y1;
+            break;
+        case 1:
+            left = PANEL_WIDTH - y1, top = x0, right = PANEL_WIDTH - y0, bottom = x1;
+            break;
+        case 2:
+            left = PANEL_WIDTH - x1, top = PANEL_HEIGHT - y1, right = PANEL_WIDTH - x0, bottom = PANEL_HEIGHT - y0;
+            break;
+        default:
+            left = y0, top = PANEL_HEIGHT - x1, right = y1, bottom = PANEL_HEIGHT - x0;
+            break;
+        }
+
+        // Clip to the current page
+        top = top > mPageTop ? top - mPageTop : 0;
+        bottom = bottom < mPageTop + mPageRows ? bottom - mPageTop : mPageRows;
+        if (top >= bottom)
+        {
+            return;
+        }
+
+        uint16_t first = left / 8;
+        uint16_t last = (right - 1) / 8;
+        uint8_t leftMask = 0xFF >> (left & 7);
+        uint8_t rightMask = 0xFF << (7 - ((right - 1) & 7));
+        if (first == last)
+        {
+            leftMask &= rightMask;
+        }
+        for (uint8_t *row = &mBuffer[top * STRIDE]; row < &mBuffer[bottom * STRIDE]; row += STRIDE)
+        {
+            if (color)
+            {
+                row[first] |= leftMask;
+                if (first != last)
+                {
+                    memset(&row[first + 1], 0xFF, last - first - 1);
+                    row[last] |= rightMask;
+                }
+            }
+            else
+            {
+                row[first] &= ~leftMask;
+                if (first != last)
+                {
+                    memset(&row[first + 1], 0x00, last - first - 1);
+                    row[last] &= ~rightMask;
+                }
+            }
+        }
+    }
+};
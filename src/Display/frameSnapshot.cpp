@@ -0,0 +1,189 @@
+#include "frameSnapshot.hpp"
+
+#include <cstring>
+
+namespace
+{
+    constexpr uint8_t MIN_RUN = 3;     // Shorter repeats are cheaper as part of a literal
+    constexpr uint8_t MAX_CHUNK = 128; // Maximum length of a run or literal
+
+    uint16_t runLength(const uint8_t *data, uint32_t pos, uint32_t size)
+    {
+        uint16_t length = 1;
+        while (pos + length < size && length < MAX_CHUNK && data[pos + length] == data[pos])
+        {
+            length++;
+        }
+        return length;
+    }
+
+    // PackBits encode data and append it to dst, returns false if it exceeds the budget
+    bool encode(const uint8_t *data, uint32_t size, uint8_t *dst, uint16_t &dstSize, uint16_t budget)
+    {
+        uint32_t pos = 0;
+        while (pos < size)
+        {
+            uint16_t run = runLength(data, pos, size);
+            if (run >= MIN_RUN)
+            {
+                if (dstSize + 2 > budget)
+                    return false;
+                dst[dstSize++] = 257 - run;
+                dst[dstSize++] = data[pos];
+                pos += run;
+                continue;
+            }
+
+            // Collect literal bytes up to the next run worth encoding
+            uint32_t start = pos;
+            while (pos < size && pos - start < MAX_CHUNK && runLength(data, pos, size) < MIN_RUN)
+            {
+                pos++;
+            }
+            uint16_t length = pos - start;
+            if (dstSize + 1 + length > budget)
+                return false;
+            dst[dstSize++] = length - 1;
+            memcpy(&dst[dstSize], &data[start], length);
+            dstSize += length;
+        }
+        return true;
+    }
+}
+
+bool FrameSnapshot::isValid() const
+{
+    return mValid;
+}
+
+void FrameSnapshot::invalidate()
+{
+    mValid = false;
+}
+
+uint16_t FrameSnapshot::size() const
+{
+    return mSize;
+}
+
+void FrameSnapshot::begin(uint16_t stride, uint16_t height, uint8_t *scratch)
+{
+    mNewStride = stride;
+    mNewHeight = height;
+    mDiffRows = 0;
+    mStoreRows = 0;
+    mTarget = scratch != nullptr ? scratch : mData;
+    mTargetSize = 0;
+    mOverflow = stride > MAX_STRIDE;
+    mReadPos = 0;
+    mRemaining = 0;
+    mLiteral = false;
+}
+
+// Sequential PackBits decoder, control byte n < 128: n + 1 literal bytes, n > 128: 257 - n repeats
+void FrameSnapshot::read(uint8_t *dst, uint16_t count)
+{
+    while (count > 0)
+    {
+        if (mRemaining == 0)
+        {
+            uint8_t control = mData[mReadPos++];
+            mLiteral = control < 128;
+            mRemaining = mLiteral ? control + 1 : 257 - control;
+        }
+
+        uint16_t n = mRemaining < count ? mRemaining : count;
+        if (mLiteral)
+        {
+            memcpy(dst, &mData[mReadPos], n);
+            mReadPos += n;
+        }
+        else
+        {
+            memset(dst, mData[mReadPos], n);
+        }
+        dst += n;
+        count -= n;
+        mRemaining -= n;
+        if (!mLiteral && mRemaining == 0)
+        {
+            mReadPos++; // Skip the repeated byte
+        }
+    }
+}
+
+uint32_t FrameSnapshot::diffPage(const uint8_t *page, uint16_t rows, uint32_t *changedWords)
+{
+    constexpr uint16_t ROW_WORDS = (MAX_STRIDE + WORD_BYTES - 1) / WORD_BYTES;
+    uint32_t previousRow[ROW_WORDS];
+    uint32_t currentRow[ROW_WORDS];
+    uint16_t stride = mNewStride;
+    uint16_t words = (stride + WORD_BYTES - 1) / WORD_BYTES;
+    uint32_t toggled = 0;
+
+    if (!mValid || stride != mStride || mNewHeight != mHeight || stride > MAX_STRIDE)
+    {
+        // Nothing to compare against, report everything as changed
+        for (uint16_t row = 0; row < rows; row++)
+        {
+            changedWords[row] = words >= 32 ? ~0UL : (1UL << words) - 1;
+        }
+        mDiffRows += rows;
+        return static_cast<uint32_t>(stride) * 8 * rows;
+    }
+
+    for (uint16_t row = 0; row < rows && mDiffRows < mHeight; row++, mDiffRows++)
+    {
+        // Copy both rows into word aligned buffers, frame rows are not necessarily aligned
+        previousRow[words - 1] = 0;
+        currentRow[words - 1] = 0;
+        read(reinterpret_cast<uint8_t *>(previousRow), stride);
+        memcpy(currentRow, &page[row * stride], stride);
+
+        uint32_t changed = 0;
+        for (uint16_t word = 0; word < words; word++)
+        {
+            uint32_t delta = previousRow[word] ^ currentRow[word];
+            if (delta)
+            {
+                changed |= 1UL << word;
+                toggled += __builtin_popcount(delta);
+            }
+        }
+        changedWords[row] = changed;
+    }
+    return toggled;
+}
+
+void FrameSnapshot::storePage(const uint8_t *page, uint16_t rows)
+{
+    if (mTarget == mData)
+    {
+        mValid = false; // The stored frame is overwritten from here on
+    }
+    if (!mOverflow)
+    {
+        mOverflow = !encode(page, static_cast<uint32_t>(mNewStride) * rows, mTarget, mTargetSize, BUDGET);
+    }
+    mStoreRows += rows;
+}
+
+bool FrameSnapshot::commit()
+{
+    mValid = false;
+    if (mOverflow || mStoreRows != mNewHeight)
+    {
+        mSize = 0;
+        return false;
+    }
+
+    if (mTarget != mData)
+    {
+        memcpy(mData, mTarget, mTargetSize);
+    }
+    mSize = mTargetSize;
+    mStride = mNewStride;
+    mHeight = mNewHeight;
+    mValid = true;
+    return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include "panelConfig.hpp"
+
+// Compressed copy of the frame shown on the panel, small enough to be kept in RTC memory.
+// The frame is stored with PackBits run length encoding, which suits the mostly white frame.
+// Diffing a new frame against it yields the changed areas without keeping a full frame buffer
+// alive across deep sleep.
+//
+// The new frame is passed page by page from top to bottom: begin(), then diffPage() and
+// storePage() for every page, finally commit(). While the stored frame is still read, the new
+// one is encoded into a scratch buffer of BUDGET bytes. Without a scratch buffer it is encoded
+// in place, which is only safe when the whole frame is passed as a single page.
+class FrameSnapshot
+{
+public:
+    static constexpr uint16_t BUDGET = PanelConfig::SNAPSHOT_BUDGET; // Maximum size of the compressed frame in bytes
+    static constexpr uint16_t MAX_STRIDE = 128;                      // Maximum bytes per frame row
+    static constexpr uint8_t WORD_BYTES = 4;                         // Diff granularity, one bit per word of a row
+
+    bool isValid() const;  // True if a frame is stored
+    void invalidate();     // Forget the stored frame
+    uint16_t size() const; // Size of the compressed frame in bytes
+
+    void begin(uint16_t stride, uint16_t height, uint8_t *scratch = nullptr); // Start passing a new frame
+
+    // Compare the next rows of the new frame with the stored one. Bit n of changedWords[row] is set if
+    // bytes n * WORD_BYTES ... n * WORD_BYTES + 3 of the row differ, everything is reported as changed
+    // if the stored frame is missing or has another geometry. Returns the number of toggled pixels.
+    uint32_t diffPage(const uint8_t *page, uint16_t rows, uint32_t *changedWords);
+    void storePage(const uint8_t *page, uint16_t rows); // Encode the next rows of the new frame
+    bool commit();                                      // Replace the stored frame, returns false if the new one exceeds the budget
+
+private:
+    uint8_t mData[BUDGET]; // PackBits encoded frame
+    uint16_t mSize;        // Bytes used in mData
+    uint16_t mStride;      // Geometry of the stored frame
+    uint16_t mHeight;
+    bool mValid;
+
+    // State while a new frame is passed
+    uint16_t mNewStride;
+    uint16_t mNewHeight;
+    uint16_t mDiffRows;    // Rows compared so far
+    uint16_t mStoreRows;   // Rows encoded so far
+    uint8_t *mTarget;      // Encoded new frame, mData or the scratch buffer
+    uint16_t mTargetSize;
+    bool mOverflow;        // New frame exceeded the budget
+    uint16_t mReadPos;     // Decoder position in mData
+    uint16_t mRemaining;   // Bytes left in the current run or literal
+    bool mLiteral;
+
+    void read(uint8_t *dst, uint16_t count); // Decode the next bytes of the stored frame
+};
@@ -0,0 +1,89 @@
+#include "glyphBlitter.hpp"
+
+#include <algorithm>
+
+namespace
+{
+    constexpr uint8_t MAX_GLYPH_WIDTH = 56; // A row plus its bit offset has to fit into 64 bits
+
+    const GFXglyph *getGlyph(const GFXfont *font, char c)
+    {
+        uint8_t code = static_cast<uint8_t>(c);
+        if (code < font->first || code > font->last)
+        {
+            return nullptr;
+        }
+        return &font->glyph[code - font->first];
+    }
+
+    // Read a row of glyph pixels starting at the given bit position, first pixel in bit 63
+    uint64_t readRow(const uint8_t *bitmap, uint32_t bitPos, uint8_t width)
+    {
+        const uint8_t *src = &bitmap[bitPos / 8];
+        uint8_t bytes = (bitPos % 8 + width + 7) / 8;
+        uint64_t row = 0;
+        for (uint8_t i = 0; i < bytes; i++)
+        {
+            row |= static_cast<uint64_t>(src[i]) << (56 - 8 * i);
+        }
+        row <<= bitPos % 8;
+        return row & (~0ULL << (64 - width));
+    }
+}
+
+bool blitText(uint8_t *frame, uint16_t stride, int16_t top, uint16_t rows, const GFXfont *font, const char *text, int16_t x, int16_t y)
+{
+    // Check all glyphs first so text is never drawn half by us and half by the fallback
+    int16_t cursor = x;
+    for (const char *c = text; *c; c++)
+    {
+        const GFXglyph *glyph = getGlyph(font, *c);
+        if (glyph == nullptr)
+        {
+            return false;
+        }
+
+        int16_t gx = cursor + glyph->xOffset;
+        if (glyph->width > 0 && glyph->height > 0 &&
+            (glyph->width > MAX_GLYPH_WIDTH || gx < 0 || gx + glyph->width > stride * 8))
+        {
+            return false;
+        }
+        cursor += glyph->xAdvance;
+    }
+
+    cursor = x;
+    for (const char *c = text; *c; c++)
+    {
+        const GFXglyph *glyph = getGlyph(font, *c);
+        int16_t gx = cursor + glyph->xOffset;
+        int16_t gy = y + glyph->yOffset;
+        cursor += glyph->xAdvance;
+
+        // Clip the glyph to the rows held by the buffer
+        int16_t first = std::max<int16_t>(0, top - gy);
+        int16_t last = std::min<int16_t>(glyph->height, top + rows - gy);
+        if (first >= last)
+        {
+            continue;
+        }
+
+        uint8_t shift = gx & 7;
+        uint8_t bytes = (shift + glyph->width + 7) / 8;
+        uint32_t bitPos = glyph->bitmapOffset * 8 + first * glyph->width;
+        uint8_t *dst = &frame[(gy + first - top) * stride + gx / 8];
+        for (int16_t row = first; row < last; row++)
+        {
+            uint64_t bits = readRow(font->bitmap, bitPos, glyph->width) >> shift;
+            bitPos += glyph->width;
+
+            // Set pixels are black, which is a cleared bit in the frame buffer
+            for (uint8_t i = 0; i < bytes; i++)
+            {
+                dst[i] &= ~static_cast<uint8_t>(bits >> (56 - 8 * i));
+            }
+            dst += stride;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <cstdint>
+#include <Adafruit_GFX.h>
+
+// Draws black text of a GFX font straight into a 1 bit frame buffer (MSB first, 1 = white).
+// Each glyph row is pulled out of the packed font bitmap as one 64 bit word and written with
+// byte masks instead of one drawPixel call per set bit. Glyphs may be up to 56 pixels wide.
+// The buffer holds the frame rows top ... top + rows - 1, glyph rows outside of them are skipped.
+// Returns false without drawing anything if a glyph would leave the frame horizontally or is
+// too wide, the caller then falls back to Adafruit GFX.
+bool blitText(uint8_t *frame, uint16_t stride, int16_t top, uint16_t rows, const GFXfont *font, const char *text, int16_t x, int16_t y);
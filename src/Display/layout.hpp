@@ -0,0 +1,132 @@
+#pragma once
+#include <cstdint>
+#include <Adafruit_GFX.h>
+
+// Text metrics of GFX fonts that can be evaluated at compile time. The fonts generated by
+// scripts/subset_fonts.py are constexpr, so all positions derived from them are constants and
+// the render path is reduced to cursor arithmetic.
+namespace Layout
+{
+    constexpr uint8_t MAX_VALUE_CELLS = 6; // Maximum number of characters of a value
+
+    // Rectangle relative to the text cursor (x) and baseline (y)
+    struct Box
+    {
+        int16_t x;
+        int16_t y;
+        int16_t w;
+        int16_t h;
+    };
+
+    // Cursor positions of a centered value with its unit, indexed by the number of characters
+    struct ValueLayout
+    {
+        int16_t valueX[MAX_VALUE_CELLS + 1]; // Cursor of the value text
+        int16_t unitX[MAX_VALUE_CELLS + 1];  // Cursor of the unit text
+        Box bounds[MAX_VALUE_CELLS + 1];     // Area covered by value and unit, y relative to the baseline
+    };
+
+    constexpr const GFXglyph &glyph(const GFXfont *font, char c)
+    {
+        return font->glyph[static_cast<uint8_t>(c) - font->first];
+    }
+
+    constexpr int16_t advance(const GFXfont *font)
+    {
+        return glyph(font, '0').xAdvance;
+    }
+
+    // Ink bounds of a text, the same result as Adafruit_GFX::getTextBounds() with the cursor at (0, 0)
+    constexpr Box measure(const GFXfont *font, const char *text)
+    {
+        int16_t cursor = 0;
+        int16_t minX = INT16_MAX, minY = INT16_MAX, maxX = INT16_MIN, maxY = INT16_MIN;
+        for (; *text; text++)
+        {
+            const GFXglyph &g = glyph(font, *text);
+            if (g.width > 0 && g.height > 0)
+            {
+                minX = cursor + g.xOffset < minX ? cursor + g.xOffset : minX;
+                minY = g.yOffset < minY ? g.yOffset : minY;
+                maxX = cursor + g.xOffset + g.width > maxX ? cursor + g.xOffset + g.width : maxX;
+                maxY = g.yOffset + g.height > maxY ? g.yOffset + g.height : maxY;
+            }
+            cursor += g.xAdvance;
+        }
+
+        Box box{0, 0, 0, 0};
+        if (maxX > minX)
+        {
+            box.x = minX;
+            box.y = minY;
+            box.w = maxX - minX;
+            box.h = maxY - minY;
+        }
+        return box;
+    }
+
+    // Ink bounds of any of the given characters drawn in a single character cell
+    constexpr Box measureCell(const GFXfont *font, const char *chars)
+    {
+        Box cell{0, 0, 0, 0};
+        for (; *chars; chars++)
+        {
+            char text[2] = {*chars, 0};
+            Box box = measure(font, text);
+            if (cell.w == 0)
+            {
+                cell = box;
+            }
+            else if (box.w > 0)
+            {
+                int16_t right = cell.x + cell.w > box.x + box.w ? cell.x + cell.w : box.x + box.w;
+                int16_t bottom = cell.y + cell.h > box.y + box.h ? cell.y + cell.h : box.y + box.h;
+                cell.x = box.x < cell.x ? box.x : cell.x;
+                cell.y = box.y < cell.y ? box.y : cell.y;
+                cell.w = right - cell.x;
+                cell.h = bottom - cell.y;
+            }
+        }
+        return cell;
+    }
+
+    // True if all given characters share the same advance
+    constexpr bool isMonospaced(const GFXfont *font, const char *chars)
+    {
+        for (; *chars; chars++)
+        {
+            if (glyph(font, *chars).xAdvance != advance(font))
+                return false;
+        }
+        return true;
+    }
+
+    // Baseline that centers the given characters vertically between top and bottom
+    constexpr int16_t centeredBaseline(const GFXfont *font, const char *chars, int16_t top, int16_t bottom)
+    {
+        return (top + bottom) / 2 - measureCell(font, chars).y - measureCell(font, chars).h / 2;
+    }
+
+    // Place a value of monospaced characters centered on centerX, followed by the unit after spacing pixels.
+    // Centering uses the character cells, so values with the same number of characters never move.
+    constexpr ValueLayout layoutValue(const GFXfont *valueFont, const char *valueChars,
+                                      const GFXfont *unitFont, const char *unit, int16_t centerX, int16_t spacing)
+    {
+        ValueLayout layout{};
+        Box value = measureCell(valueFont, valueChars);
+        Box unitBox = measure(unitFont, unit);
+        int16_t top = value.y < unitBox.y ? value.y : unitBox.y;
+        int16_t bottom = value.y + value.h > unitBox.y + unitBox.h ? value.y + value.h : unitBox.y + unitBox.h;
+        int16_t rightBearing = advance(valueFont) - value.x - value.w; // Blank space right of the ink in the last cell
+
+        for (uint8_t cells = 0; cells <= MAX_VALUE_CELLS; cells++)
+        {
+            int16_t valueX = centerX - cells * advance(valueFont) / 2;
+            int16_t unitX = valueX + cells * advance(valueFont) - rightBearing + spacing - unitBox.x;
+            layout.valueX[cells] = valueX;
+            layout.unitX[cells] = unitX;
+            layout.bounds[cells] = Box{valueX, top, static_cast<int16_t>(unitX + unitBox.x + unitBox.w - valueX), static_cast<int16_t>(bottom - top)};
+        }
+        return layout;
+    }
+}
@@ -0,0 +1,406 @@
+#include "panel.hpp"
+#ifdef DISPLAY_SPI_DMA
+#include <SPI.h>
+#include <algorithm>
+#endif
+
+#ifdef DISPLAY_PANEL_SSD16XX
+namespace
+{
+    // SSD16xx commands
+    constexpr uint8_t CMD_DRIVER_OUTPUT = 0x01;
+    constexpr uint8_t CMD_DEEP_SLEEP = 0x10;
+    constexpr uint8_t CMD_DATA_ENTRY_MODE = 0x11;
+    constexpr uint8_t CMD_TEMPERATURE_SENSOR = 0x18;
+    constexpr uint8_t CMD_TEMPERATURE_REGISTER = 0x1A;
+    constexpr uint8_t CMD_MASTER_ACTIVATION = 0x20;
+    constexpr uint8_t CMD_UPDATE_CONTROL_1 = 0x21;
+    constexpr uint8_t CMD_UPDATE_CONTROL_2 = 0x22;
+    constexpr uint8_t CMD_BORDER_WAVEFORM = 0x3C;
+    constexpr uint8_t CMD_RAM_X_RANGE = 0x44;
+    constexpr uint8_t CMD_RAM_Y_RANGE = 0x45;
+    constexpr uint8_t CMD_RAM_X_COUNTER = 0x4E;
+    constexpr uint8_t CMD_RAM_Y_COUNTER = 0x4F;
+
+    constexpr uint8_t DEEP_SLEEP_MODE_1 = 0x01;       // Deep sleep that keeps the RAM content
+    constexpr uint8_t UPDATE_FULL = 0xF7;             // Clock and analog on, load temperature and LUT, display mode 1, power off
+    constexpr uint8_t UPDATE_PARTIAL = 0xFC;          // Clock and analog on, load temperature and LUT, display mode 2 (differential)
+    constexpr uint8_t UPDATE_LOAD_TEMPERATURE = 0x20; // Read the temperature sensor before loading the LUT
+    constexpr uint8_t UPDATE_POWER_OFF = 0x83;        // Analog and clock off
+    constexpr uint8_t UPDATE_THEN_POWER_OFF = 0x03;   // Analog and clock off at the end of an update sequence
+    constexpr uint8_t FAST_FULL_TEMPERATURE = 110;    // Temperature in C whose OTP waveform gives the fast full refresh
+#ifdef DISPLAY_PANEL_290
+    constexpr bool FAST_FULL_REFRESH = false;         // No fast full refresh waveform known for this OTP
+    constexpr uint8_t SOURCE_OUTPUT = 0x80;           // Update control 1 source output mode, S8 to S167 drive the 128 columns
+#else
+    constexpr bool FAST_FULL_REFRESH = true;
+    constexpr uint8_t SOURCE_OUTPUT = 0x00;           // Update control 1 source output mode, all sources
+#endif
+    constexpr uint16_t FULL_REFRESH_TIME = 4000;      // Expected duration of a full refresh in ms
+    constexpr uint16_t PARTIAL_REFRESH_TIME = 800;    // Expected duration of a partial refresh in ms
+    constexpr uint16_t POWER_OFF_TIME = 200;          // Expected duration of the power off sequence in ms
+#ifdef DISPLAY_SPI_DMA
+    constexpr int DMA_SPI_CLOCK = 20000000;                                            // Fastest write clock of the SSD16xx serial interface (50 ns cycle)
+    constexpr uint32_t DMA_MAX_TRANSFER = PanelDriver::WIDTH / 8 * PanelDriver::HEIGHT; // Largest single transaction, a whole plane
+#endif
+}
+
+void Panel::initController()
+{
+    // The hardware reset of init() leaves deep sleep and restores the register defaults. Deep sleep mode 1
+    // keeps both RAM planes. Only the registers that differ from their reset value have to be written again.
+    writeCommand(CMD_DRIVER_OUTPUT);
+    writeData((HEIGHT - 1) % 256);
+    writeData((HEIGHT - 1) / 256);
+    writeData(0x00);
+    writeCommand(CMD_BORDER_WAVEFORM);
+    writeData(0x05);
+    writeCommand(CMD_TEMPERATURE_SENSOR);
+    writeData(0x80); // Internal sensor
+    _power_is_on = false;
+    _using_partial_mode = true;
+}
+
+void Panel::setRamWindow(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+    writeCommand(CMD_DATA_ENTRY_MODE);
+    writeData(0x03); // X and Y increment
+    writeCommand(CMD_RAM_X_RANGE);
+    writeData(x / 8);
+    writeData((x + w - 1) / 8);
+    writeCommand(CMD_RAM_Y_RANGE);
+    writeData(y % 256);
+    writeData(y / 256);
+    writeData((y + h - 1) % 256);
+    writeData((y + h - 1) / 256);
+    writeCommand(CMD_RAM_X_COUNTER);
+    writeData(x / 8);
+    writeCommand(CMD_RAM_Y_COUNTER);
+    writeData(y % 256);
+    writeData(y / 256);
+}
+
+void Panel::writePlane(uint8_t plane, const uint8_t *rows, uint16_t stride, int16_t x, int16_t y, int16_t w, int16_t h)
+{
+    setRamWindow(x, y, w, h);
+    writeCommand(plane);
+    startData();
+    if (x == 0 && w / 8 == stride)
+    {
+        writeBytes(rows, stride * h); // Whole rows are contiguous in the buffer
+    }
+    else
+    {
+        for (int16_t row = 0; row < h; row++)
+        {
+            writeBytes(&rows[row * stride + x / 8], w / 8);
+        }
+    }
+    endData();
+}
+
+void Panel::setWaveformMode(WaveformMode mode, int16_t temperature)
+{
+    mWaveformMode = mode == WAVEFORM_FAST && !FAST_FULL_REFRESH ? WAVEFORM_NORMAL : mode;
+    mTemperature = temperature;
+}
+
+// Override the temperature register, the LUT is then loaded for this temperature instead of the sensor reading
+// The register holds 12 bit two's complement in sixteenths of a degree, so temperatures below 0 C stay negative.
+void Panel::writeTemperature(int16_t temperature)
+{
+    int16_t sixteenths = static_cast<int32_t>(temperature) * 16 / 100;
+    writeCommand(CMD_TEMPERATURE_REGISTER);
+    writeData(static_cast<uint8_t>(sixteenths >> 4)); // Whole degrees, rounded down
+    writeData((sixteenths & 0x0F) << 4);              // Sixteenths of a degree in the upper nibble
+}
+
+// Start a full refresh of the new-data plane, finishRefresh() waits for it
+void Panel::startRefreshFull()
+{
+    uint8_t sequence = UPDATE_FULL;
+    if (mWaveformMode != WAVEFORM_COLD)
+    {
+        writeTemperature(mWaveformMode == WAVEFORM_FAST ? FAST_FULL_TEMPERATURE * 100 : mTemperature);
+        sequence &= ~UPDATE_LOAD_TEMPERATURE;
+    }
+    writeCommand(CMD_UPDATE_CONTROL_1);
+    writeData(0x40); // Previous-image plane read as 0, a full refresh drives every pixel
+    writeData(SOURCE_OUTPUT);
+    writeCommand(CMD_UPDATE_CONTROL_2);
+    writeData(sequence);
+    writeCommand(CMD_MASTER_ACTIVATION);
+    mRefreshing = true;
+    mRefreshFull = true;
+}
+
+// Start a differential refresh of the new-data plane against the previous one, finishRefresh() waits for it.
+// With powerOff the sequence ends like a full one, for a refresh nobody waits for to power the controller down.
+void Panel::startRefreshPartial(bool powerOff)
+{
+    uint8_t sequence = powerOff ? UPDATE_PARTIAL | UPDATE_THEN_POWER_OFF : UPDATE_PARTIAL;
+    if (mWaveformMode != WAVEFORM_COLD)
+    {
+        writeTemperature(mTemperature); // The fast waveform exists only for full refreshes
+        sequence &= ~UPDATE_LOAD_TEMPERATURE;
+    }
+    writeCommand(CMD_UPDATE_CONTROL_1);
+    writeData(0x00); // Use both RAM planes
+    writeData(SOURCE_OUTPUT);
+    writeCommand(CMD_UPDATE_CONTROL_2);
+    writeData(sequence);
+    writeCommand(CMD_MASTER_ACTIVATION);
+    mRefreshing = true;
+    mRefreshFull = false;
+}
+
+void Panel::finishRefresh()
+{
+    if (!mRefreshing)
+        return;
+
+    mRefreshing = false;
+    if (mRefreshFull)
+    {
+        _waitWhileBusy("refreshFull", FULL_REFRESH_TIME);
+        _power_is_on = false; // The full sequence ends with power off
+        _initial_refresh = false;
+    }
+    else
+    {
+        _waitWhileBusy("refreshPartial", PARTIAL_REFRESH_TIME);
+        _power_is_on = true;
+    }
+}
+
+// The controller runs the refresh to its end on its own. Only the refreshes that power off afterwards may be released.
+void Panel::releaseRefresh()
+{
+    if (!mRefreshing)
+        return;
+
+    mRefreshing = false;
+    _power_is_on = false;
+    if (mRefreshFull)
+    {
+        _initial_refresh = false;
+    }
+}
+
+void Panel::sleepRetained()
+{
+    if (_power_is_on)
+    {
+        writeCommand(CMD_UPDATE_CONTROL_2);
+        writeData(UPDATE_POWER_OFF);
+        writeCommand(CMD_MASTER_ACTIVATION);
+        _waitWhileBusy("sleepRetained", POWER_OFF_TIME);
+        _power_is_on = false;
+    }
+    writeCommand(CMD_DEEP_SLEEP);
+    writeData(DEEP_SLEEP_MODE_1);
+    _hibernating = true;
+}
+#else
+// The controller has no temperature override, it always loads the waveforms for its own sensor
+void Panel::setWaveformMode(WaveformMode mode, int16_t temperature)
+{
+    mWaveformMode = mode;
+    mTemperature = temperature;
+}
+
+// GxEPD2 runs the whole refresh including the wait, finishRefresh() has nothing left to do
+void Panel::startRefreshFull()
+{
+    refresh(false);
+}
+
+void Panel::startRefreshPartial(bool)
+{
+    refresh(true);
+}
+
+void Panel::finishRefresh()
+{
+}
+
+void Panel::releaseRefresh()
+{
+}
+#endif
+
+#ifdef DISPLAY_SPI_DMA
+bool Panel::beginDma(int8_t sclk, int8_t mosi)
+{
+    SPI.end(); // The IDF driver needs the peripheral for itself, CS and DC stay plain GPIOs as with GxEPD2
+
+    spi_bus_config_t bus = {};
+    bus.mosi_io_num = mosi;
+    bus.miso_io_num = -1;
+    bus.sclk_io_num = sclk;
+    bus.quadwp_io_num = -1;
+    bus.quadhd_io_num = -1;
+    bus.max_transfer_sz = DMA_MAX_TRANSFER;
+    if (spi_bus_initialize(SPI2_HOST, &bus, SPI_DMA_CH_AUTO) != ESP_OK)
+    {
+        return false;
+    }
+
+    spi_device_interface_config_t device = {};
+    device.clock_speed_hz = DMA_SPI_CLOCK;
+    device.mode = 0;
+    device.spics_io_num = -1;
+    device.queue_size = DMA_QUEUE_SIZE;
+    if (spi_bus_add_device(SPI2_HOST, &device, &mDevice) != ESP_OK)
+    {
+        spi_bus_free(SPI2_HOST);
+        mDevice = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void Panel::endDma()
+{
+    if (mDevice)
+    {
+        spi_bus_remove_device(mDevice);
+        spi_bus_free(SPI2_HOST);
+        mDevice = nullptr;
+    }
+}
+
+uint32_t Panel::getDmaWaitTime()
+{
+    uint32_t time = mDmaWaitTime;
+    mDmaWaitTime = 0;
+    return time;
+}
+
+// Block until the oldest queued transaction is done. The task sleeps on the driver's completion
+// interrupt, so the CPU halts in the idle task instead of feeding the SPI peripheral byte by byte.
+void Panel::waitTransaction()
+{
+    spi_transaction_t *done;
+    uint32_t start = micros();
+    spi_device_get_trans_result(mDevice, &done, portMAX_DELAY);
+    mDmaWaitTime += micros() - start;
+    mQueuedTransactions--;
+}
+
+// Single bytes are sent from the transaction itself and polled, queueing them costs more than the transfer
+void Panel::writeByte(uint8_t value)
+{
+    spi_transaction_t transaction = {};
+    transaction.flags = SPI_TRANS_USE_TXDATA;
+    transaction.length = 8;
+    transaction.tx_data[0] = value;
+    digitalWrite(_cs, LOW);
+    spi_device_polling_transmit(mDevice, &transaction);
+    digitalWrite(_cs, HIGH);
+}
+
+void Panel::writeCommand(uint8_t command)
+{
+    if (!mDevice)
+    {
+        _writeCommand(command);
+        return;
+    }
+    digitalWrite(_dc, LOW);
+    writeByte(command);
+    digitalWrite(_dc, HIGH);
+}
+
+void Panel::writeData(uint8_t data)
+{
+    if (!mDevice)
+    {
+        _writeData(data);
+        return;
+    }
+    writeByte(data);
+}
+
+void Panel::startData()
+{
+    if (!mDevice)
+    {
+        _startTransfer();
+        return;
+    }
+    digitalWrite(_cs, LOW);
+}
+
+void Panel::writeBytes(const uint8_t *data, uint32_t size)
+{
+    if (!mDevice)
+    {
+        for (uint32_t i = 0; i < size; i++)
+        {
+            _transfer(data[i]);
+        }
+        return;
+    }
+
+    while (size > 0)
+    {
+        if (mQueuedTransactions == DMA_QUEUE_SIZE)
+        {
+            waitTransaction();
+        }
+        uint32_t length = std::min(size, DMA_MAX_TRANSFER);
+        spi_transaction_t &transaction = mTransactions[mNextTransaction];
+        mNextTransaction = (mNextTransaction + 1) % DMA_QUEUE_SIZE;
+        transaction = {};
+        transaction.length = length * 8;
+        transaction.tx_buffer = data;
+        spi_device_queue_trans(mDevice, &transaction, portMAX_DELAY);
+        mQueuedTransactions++;
+        data += length;
+        size -= length;
+    }
+}
+
+void Panel::endData()
+{
+    if (!mDevice)
+    {
+        _endTransfer();
+        return;
+    }
+    while (mQueuedTransactions > 0)
+    {
+        waitTransaction();
+    }
+    digitalWrite(_cs, HIGH);
+}
+#elif defined(DISPLAY_PANEL_SSD16XX)
+void Panel::writeCommand(uint8_t command)
+{
+    _writeCommand(command);
+}
+
+void Panel::writeData(uint8_t data)
+{
+    _writeData(data);
+}
+
+void Panel::startData()
+{
+    _startTransfer();
+}
+
+void Panel::writeBytes(const uint8_t *data, uint32_t size)
+{
+    for (uint32_t i = 0; i < size; i++)
+    {
+        _transfer(data[i]);
+    }
+}
+
+void Panel::endData()
+{
+    _endTransfer();
+}
+#endif
@@ -0,0 +1,88 @@
+#pragma once
+#include <GxEPD2_BW.h>
+#include "panelConfig.hpp"
+#ifdef DISPLAY_SPI_DMA
+#include <driver/spi_master.h>
+#endif
+
+#if defined(DISPLAY_PANEL_290)
+using PanelDriver = GxEPD2_290_GDEY029T94; // 2.9" 128x296, SSD1680
+#elif defined(DISPLAY_PANEL_750)
+using PanelDriver = GxEPD2_750_GDEY075T7; // 7.5" 800x480, UC8179
+#else
+using PanelDriver = GxEPD2_420_GDEY042T81; // 4.2" 400x300, SSD1683
+#endif
+
+#if !defined(DISPLAY_PANEL_SSD16XX) && (defined(DISPLAY_RETAIN_RAM) || defined(DISPLAY_SPI_DMA))
+#error "DISPLAY_RETAIN_RAM and DISPLAY_SPI_DMA need a panel with an SSD16xx controller"
+#endif
+#if defined(DISPLAY_SLEEP_DURING_REFRESH) && !defined(DISPLAY_RETAIN_RAM)
+#error "DISPLAY_SLEEP_DURING_REFRESH needs DISPLAY_RETAIN_RAM, the controller keeps the frame until the next wake"
+#endif
+
+// GxEPD2 driver of the panel extended with direct access to the SSD16xx RAM planes. Used to keep the
+// controller in deep sleep mode 1, where both planes survive, and to update only windows of
+// the new-data plane without going through the full GxEPD2 initialisation again. Mode 1 keeps the
+// RAM powered and draws more sleep current than mode 2, which discards it.
+// Refreshes go through the panel so the waveform can be chosen from the ambient temperature. They are
+// split into start and finish, so the MCU can do other work while the waveform runs.
+// With DISPLAY_SPI_DMA all of the panel's own writes go through the ESP-IDF SPI master driver and
+// DMA instead of Arduino SPI. The GxEPD2 write and hibernate functions must not be used then.
+// Panels with another controller only get the refresh functions, they run the blocking GxEPD2 refresh.
+class Panel : public PanelDriver
+{
+public:
+    enum WaveformMode : uint8_t
+    {
+        WAVEFORM_COLD,   // OTP waveforms for the temperature measured by the panel itself
+        WAVEFORM_NORMAL, // OTP waveforms for the ambient temperature measured by the sensor
+        WAVEFORM_FAST,   // Fast full refresh waveform, only correct at room temperature
+        WAVEFORM_COUNT
+    };
+
+    static constexpr uint8_t PLANE_NEW = 0x24;      // Write RAM (black/white), the image to show
+    static constexpr uint8_t PLANE_PREVIOUS = 0x26; // Write RAM (red), the image shown before
+
+    using PanelDriver::PanelDriver;
+
+#ifdef DISPLAY_PANEL_SSD16XX
+    void initController();                                                                               // Write the registers that differ from their reset value after init() reset the controller
+    void writePlane(uint8_t plane, const uint8_t *rows, uint16_t stride, int16_t x, int16_t y, int16_t w, int16_t h); // Write a byte aligned window into a RAM plane, rows points at the buffer row holding row y
+    void sleepRetained();                                                                                // Power off and enter deep sleep mode 1, RAM content is kept
+#endif
+    void setWaveformMode(WaveformMode mode, int16_t temperature);                                        // Select the waveforms for the following refreshes, temperature in 1/100 C
+    void startRefreshFull();                                                                             // Start a full refresh of the new-data plane
+    void startRefreshPartial(bool powerOff = false);                                                     // Start a differential refresh of the new-data plane against the previous one, optionally powering off after it
+    void finishRefresh();                                                                                // Wait for a started refresh to complete, returns at once without one
+    void releaseRefresh();                                                                               // Leave a started refresh to the controller without waiting, it ends powered off
+#ifdef DISPLAY_SPI_DMA
+    bool beginDma(int8_t sclk, int8_t mosi); // Take the SPI bus over from Arduino SPI, call after init()
+    void endDma();                           // Release the SPI bus again
+    uint32_t getDmaWaitTime();               // Time in us the CPU was blocked on DMA transfers since the last call
+#endif
+
+private:
+    WaveformMode mWaveformMode = WAVEFORM_COLD;
+    int16_t mTemperature = 0;  // Ambient temperature in 1/100 C
+    bool mRefreshing = false;  // A refresh was started and not waited for yet
+    bool mRefreshFull = false; // The started refresh is a full one
+#ifdef DISPLAY_PANEL_SSD16XX
+    void setRamWindow(int16_t x, int16_t y, int16_t w, int16_t h);
+    void writeTemperature(int16_t temperature);
+    void writeCommand(uint8_t command);
+    void writeData(uint8_t data);
+    void startData();                                    // Select the controller for a block of data
+    void writeBytes(const uint8_t *data, uint32_t size); // Queue data, it has to stay valid until endData()
+    void endData();                                      // Wait for all queued data and deselect the controller
+#endif
+#ifdef DISPLAY_SPI_DMA
+    static constexpr uint8_t DMA_QUEUE_SIZE = 8;     // Transactions in flight, narrow windows queue one per row
+    spi_device_handle_t mDevice = nullptr;           // Set while the IDF driver owns the bus
+    spi_transaction_t mTransactions[DMA_QUEUE_SIZE];
+    uint8_t mNextTransaction = 0;
+    uint8_t mQueuedTransactions = 0;
+    uint32_t mDmaWaitTime = 0; // Time in us blocked on DMA transfers
+    void writeByte(uint8_t value);
+    void waitTransaction();
+#endif
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+
+// Panel the firmware is built for, selected with DISPLAY_PANEL_290 or DISPLAY_PANEL_750 and the 4.2"
+// panel otherwise. The frame buffer, the fonts and every position of the layout are derived from it at
+// compile time, a build carries nothing of the other panels. The driver class is picked in panel.hpp.
+// The RTC memory budgets of the static layer and the frame snapshot are sized to the frames of each panel,
+// the sizes in use were measured on the host.
+#if defined(DISPLAY_PANEL_290) && defined(DISPLAY_PANEL_750)
+#error "Select a single panel"
+#endif
+
+// Panels with an SSD16xx controller, the RAM plane and waveform extensions of Panel need its command set
+#ifndef DISPLAY_PANEL_750
+#define DISPLAY_PANEL_SSD16XX
+#endif
+
+namespace PanelConfig
+{
+#if defined(DISPLAY_PANEL_290)
+    constexpr const char *NAME = "2.9\" GDEY029T94";
+    constexpr uint16_t WIDTH = 128;   // Visible columns
+    constexpr uint16_t HEIGHT = 296;  // Rows
+    constexpr bool STACKED = true;    // Readings stacked below each other, the panel is too narrow for two columns
+    constexpr uint8_t BUSY_LEVEL = 1; // Level of the BUSY line while the controller works
+    constexpr uint16_t STATIC_LAYER_BUDGET = 1536; // RTC memory in bytes for the static layer, 416 bytes are used
+    constexpr uint16_t SNAPSHOT_BUDGET = 4096;     // RTC memory in bytes for the frame snapshot, up to 1.7 kB with a full chart
+#elif defined(DISPLAY_PANEL_750)
+    constexpr const char *NAME = "7.5\" GDEY075T7";
+    constexpr uint16_t WIDTH = 800;
+    constexpr uint16_t HEIGHT = 480;
+    constexpr bool STACKED = false;   // CO2 in the top half, humidity and temperature side by side below
+    constexpr uint8_t BUSY_LEVEL = 0; // The UC8179 pulls BUSY low while it works
+    constexpr uint16_t STATIC_LAYER_BUDGET = 2048; // 2001 bytes are used
+    constexpr uint16_t SNAPSHOT_BUDGET = 7168;     // Up to 6.0 kB with a full chart
+#else
+    constexpr const char *NAME = "4.2\" GDEY042T81";
+    constexpr uint16_t WIDTH = 400;
+    constexpr uint16_t HEIGHT = 300;
+    constexpr bool STACKED = false;
+    constexpr uint8_t BUSY_LEVEL = 1;
+    constexpr uint16_t STATIC_LAYER_BUDGET = 1536; // 935 bytes are used
+    constexpr uint16_t SNAPSHOT_BUDGET = 4096;     // Up to 3.6 kB with a full chart
+#endif
+}
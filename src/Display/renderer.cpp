@@ -0,0 +1,527 @@
+#include "renderer.hpp"
+#include "glyphBlitter.hpp"
+#include "layout.hpp"
+#include "segmentFont.hpp"
+
+#include <algorithm>
+
+// Fonts reduced to the rendered characters by scripts/subset_fonts.py. With DISPLAY_SEGMENT_DIGITS the values
+// are drawn as seven segment digits and the large fonts are left out.
+#if defined(DISPLAY_PANEL_290)
+#ifndef DISPLAY_SEGMENT_DIGITS
+#include <subset/FreeMonoBold18pt7b.h>
+#endif
+#include <subset/FreeMonoBold9pt7b.h>
+#elif defined(DISPLAY_PANEL_750)
+#ifndef DISPLAY_SEGMENT_DIGITS
+#include <subset/FreeMonoBold36pt7b.h>
+#include <subset/FreeMonoBold30pt7b.h>
+#endif
+#include <subset/FreeMonoBold18pt7b.h>
+#include <subset/FreeMonoBold12pt7b.h>
+#else
+#ifndef DISPLAY_SEGMENT_DIGITS
+#include <subset/FreeMonoBold30pt7b.h>
+#include <subset/FreeMonoBold24pt7b.h>
+#endif
+#include <subset/FreeMonoBold12pt7b.h>
+#include <subset/FreeMonoBold9pt7b.h>
+#endif
+
+namespace
+{
+    constexpr uint16_t COLOR_BLACK = 0x0000;                  // Same value as GxEPD_BLACK, without the panel driver
+    constexpr uint16_t COLOR_WHITE = 0xFFFF;                  // Same value as GxEPD_WHITE
+    constexpr uint16_t DISPLAY_MARGIN = 2;                    // Margin around the display
+    constexpr uint16_t DISPLAY_CENTER_X = DISPLAY_WIDTH / 2;  // Center X position
+    constexpr uint16_t DISPLAY_CENTER_Y = DISPLAY_HEIGHT / 2; // Center Y position
+    constexpr uint16_t BATTERY_ICON_WIDTH = 20;               // Width of the battery icon
+    constexpr uint16_t BATTERY_ICON_HEIGHT = 15;              // Height of the battery icon
+    constexpr const char *LABEL_HUMIDITY = "Humidity";
+    constexpr const char *LABEL_TEMPERATURE = "Temperature";
+    constexpr const char *LABEL_CO2 = "CO2";
+    constexpr const char *UNIT_PERCENT = "%";
+    constexpr const char *UNIT_CELSIUS = "C";
+    constexpr const char *UNIT_PPM = "ppm";
+
+    // Font definitions and spacing, scaled to the panel
+#if defined(DISPLAY_PANEL_290)
+#ifdef DISPLAY_SEGMENT_DIGITS
+    constexpr auto FONT_CO2 = &SegmentFont<22>::FONT;         // Font for CO2 value
+    constexpr auto FONT_HUMIDITY = &SegmentFont<22>::FONT;    // Font for humidity
+    constexpr auto FONT_TEMPERATURE = &SegmentFont<22>::FONT; // Font for temperature
+#else
+    constexpr auto FONT_CO2 = &FreeMonoBold18pt7b;
+    constexpr auto FONT_HUMIDITY = &FreeMonoBold18pt7b;
+    constexpr auto FONT_TEMPERATURE = &FreeMonoBold18pt7b;
+#endif
+    constexpr auto FONT_LABEL = &FreeMonoBold9pt7b; // Font for labels
+    constexpr auto FONT_UNIT = &FreeMonoBold9pt7b;  // Font for units (%, C, ppm)
+    constexpr auto FONT_CLOCK = &FreeMonoBold9pt7b; // Font for clock
+    constexpr uint16_t UNIT_SPACING = 4;                   // Spacing between value and unit
+    constexpr int16_t ERROR_LINE_SPACING = 30;             // Baseline distance of the two lines of the error screen
+#elif defined(DISPLAY_PANEL_750)
+#ifdef DISPLAY_SEGMENT_DIGITS
+    constexpr auto FONT_CO2 = &SegmentFont<44>::FONT;
+    constexpr auto FONT_HUMIDITY = &SegmentFont<36>::FONT;
+    constexpr auto FONT_TEMPERATURE = &SegmentFont<36>::FONT;
+#else
+    constexpr auto FONT_CO2 = &FreeMonoBold36pt7b;
+    constexpr auto FONT_HUMIDITY = &FreeMonoBold30pt7b;
+    constexpr auto FONT_TEMPERATURE = &FreeMonoBold30pt7b;
+#endif
+    constexpr auto FONT_LABEL = &FreeMonoBold18pt7b;
+    constexpr auto FONT_UNIT = &FreeMonoBold12pt7b;
+    constexpr auto FONT_CLOCK = &FreeMonoBold18pt7b;
+    constexpr uint16_t UNIT_SPACING = 16;
+    constexpr int16_t ERROR_LINE_SPACING = 60;
+#else
+#ifdef DISPLAY_SEGMENT_DIGITS
+    constexpr auto FONT_CO2 = &SegmentFont<36>::FONT;
+    constexpr auto FONT_HUMIDITY = &SegmentFont<30>::FONT;
+    constexpr auto FONT_TEMPERATURE = &SegmentFont<30>::FONT;
+#else
+    constexpr auto FONT_CO2 = &FreeMonoBold30pt7b;
+    constexpr auto FONT_HUMIDITY = &FreeMonoBold24pt7b;
+    constexpr auto FONT_TEMPERATURE = &FreeMonoBold24pt7b;
+#endif
+    constexpr auto FONT_LABEL = &FreeMonoBold12pt7b;
+    constexpr auto FONT_UNIT = &FreeMonoBold9pt7b;
+    constexpr auto FONT_CLOCK = &FreeMonoBold12pt7b;
+    constexpr uint16_t UNIT_SPACING = 12;
+    constexpr int16_t ERROR_LINE_SPACING = 50;
+#endif
+
+    // Characters of values and labels, used to derive the layout from the font metrics
+    constexpr const char *VALUE_CHARS = "0123456789.";
+    constexpr const char *CLOCK_CHARS = "0123456789:";
+    constexpr const char *LABEL_CHARS = "CO2HumidityTemperature";
+    constexpr int16_t LABEL_PADDING = 10; // Space between the bottom of a label and the border of its section
+    static_assert(Layout::isMonospaced(FONT_CO2, VALUE_CHARS) && Layout::isMonospaced(FONT_HUMIDITY, VALUE_CHARS) &&
+                      Layout::isMonospaced(FONT_TEMPERATURE, VALUE_CHARS) && Layout::isMonospaced(FONT_CLOCK, CLOCK_CHARS),
+                  "Value fonts must be monospaced");
+    // The minus sign of temperatures below 0 C takes a character cell but is not part of the cell ink, it is wider than
+    // the digits in the GFX fonts. It only ever stands left of a digit, so its ink stays within the bounds of the value.
+    static_assert(Layout::isMonospaced(FONT_TEMPERATURE, "-"), "The minus sign must take a character cell");
+
+    // Clock positions (top left corner)
+    constexpr int16_t CLOCK_X = DISPLAY_MARGIN;
+    constexpr int16_t CLOCK_Y = DISPLAY_MARGIN - Layout::measureCell(FONT_CLOCK, CLOCK_CHARS).y;
+    constexpr Layout::Box CLOCK_BOUNDS = {CLOCK_X, CLOCK_Y + Layout::measureCell(FONT_CLOCK, CLOCK_CHARS).y,
+                                          5 * Layout::advance(FONT_CLOCK), Layout::measureCell(FONT_CLOCK, CLOCK_CHARS).h}; // "hh:mm"
+
+    // Battery icon positions (top right corner)
+    constexpr uint16_t BATTERY_ICON_X = DISPLAY_WIDTH - DISPLAY_MARGIN - BATTERY_ICON_WIDTH - 10;
+    constexpr uint16_t BATTERY_ICON_Y = DISPLAY_MARGIN + 2;
+    constexpr int16_t STATUS_BAR_BOTTOM = BATTERY_ICON_Y + BATTERY_ICON_HEIGHT + DISPLAY_MARGIN;
+
+    // CO2 history chart, centered in the status bar or on stacked layouts in a strip at the bottom. The scale is
+    // fixed, so a new value only changes its own column and the column of the gap in front of it.
+    constexpr uint16_t CHART_HEIGHT = BATTERY_ICON_HEIGHT;
+    constexpr uint16_t CHART_MIN_PPM = 400;  // CO2 at the bottom of the chart
+    constexpr uint16_t CHART_MAX_PPM = 2000; // CO2 at the top of the chart, higher values are clipped
+    constexpr int16_t CHART_X = DISPLAY_CENTER_X - CHART_COLUMNS / 2;
+    constexpr int16_t CHART_Y = PanelConfig::STACKED ? DISPLAY_HEIGHT - DISPLAY_MARGIN - CHART_HEIGHT : BATTERY_ICON_Y;
+    constexpr int16_t SECTIONS_BOTTOM = PanelConfig::STACKED ? CHART_Y - DISPLAY_MARGIN : DISPLAY_HEIGHT - DISPLAY_MARGIN; // Bottom of the reading sections
+    static_assert(PanelConfig::STACKED || (CHART_X > CLOCK_BOUNDS.x + CLOCK_BOUNDS.w && CHART_X + CHART_COLUMNS < BATTERY_ICON_X - 16),
+                  "The chart has to fit between clock and battery");
+
+    // Labels sit on a common baseline at the bottom of their section
+    constexpr Layout::Box LABEL_CELL = Layout::measureCell(FONT_LABEL, LABEL_CHARS);
+    constexpr int16_t LABEL_DESCENT = LABEL_CELL.y + LABEL_CELL.h;
+
+    // Area of a reading, the value is centered above the label at the bottom
+    struct Section
+    {
+        int16_t top;
+        int16_t bottom;
+        int16_t centerX;
+    };
+
+    // Sections of the readings. CO2 fills the top half with humidity and temperature side by side below,
+    // on narrow panels the three are stacked below each other.
+    constexpr int16_t SECTION_HEIGHT = (SECTIONS_BOTTOM - STATUS_BAR_BOTTOM) / 3; // Height of a stacked section
+    constexpr Section CO2_SECTION = PanelConfig::STACKED
+                                        ? Section{STATUS_BAR_BOTTOM, STATUS_BAR_BOTTOM + SECTION_HEIGHT, DISPLAY_CENTER_X}
+                                        : Section{STATUS_BAR_BOTTOM, DISPLAY_CENTER_Y, DISPLAY_CENTER_X};
+    constexpr Section TEMPERATURE_SECTION = PanelConfig::STACKED
+                                                ? Section{CO2_SECTION.bottom, CO2_SECTION.bottom + SECTION_HEIGHT, DISPLAY_CENTER_X}
+                                                : Section{DISPLAY_CENTER_Y, SECTIONS_BOTTOM, DISPLAY_CENTER_X + (DISPLAY_CENTER_X / 2)};
+    constexpr Section HUMIDITY_SECTION = PanelConfig::STACKED
+                                             ? Section{TEMPERATURE_SECTION.bottom, SECTIONS_BOTTOM, DISPLAY_CENTER_X}
+                                             : Section{DISPLAY_CENTER_Y, SECTIONS_BOTTOM, DISPLAY_CENTER_X / 2};
+
+    // Grid lines between the sections
+    constexpr Rect GRID_LINES[] = {
+        {DISPLAY_MARGIN, TEMPERATURE_SECTION.top, DISPLAY_WIDTH - 2 * DISPLAY_MARGIN + 1, 1},
+        PanelConfig::STACKED ? Rect{DISPLAY_MARGIN, HUMIDITY_SECTION.top, DISPLAY_WIDTH - 2 * DISPLAY_MARGIN + 1, 1}
+                             : Rect{DISPLAY_CENTER_X, DISPLAY_CENTER_Y, 1, DISPLAY_HEIGHT - DISPLAY_MARGIN - DISPLAY_CENTER_Y + 1},
+    };
+
+    // Baseline of the label at the bottom of a section
+    constexpr int16_t labelBaseline(const Section &section)
+    {
+        return section.bottom - LABEL_PADDING - LABEL_DESCENT;
+    }
+
+    // Baseline of a value centered between the top of a section and its label
+    constexpr int16_t valueBaseline(const GFXfont *font, const Section &section)
+    {
+        return Layout::centeredBaseline(font, VALUE_CHARS, section.top, labelBaseline(section) + LABEL_CELL.y);
+    }
+
+    // Center of a value, on stacked layouts the value is centered together with its unit to keep the unit on the panel
+    constexpr int16_t valueCenterX(const Section &section, const char *unit)
+    {
+        return PanelConfig::STACKED ? section.centerX - (UNIT_SPACING + Layout::measure(FONT_UNIT, unit).w) / 2 : section.centerX;
+    }
+
+    // CO2 label and value positions
+    constexpr int16_t CO2_LABEL_Y = labelBaseline(CO2_SECTION);
+    constexpr int16_t CO2_VALUE_Y = valueBaseline(FONT_CO2, CO2_SECTION);
+    constexpr Layout::ValueLayout CO2_LAYOUT = Layout::layoutValue(FONT_CO2, VALUE_CHARS, FONT_UNIT, UNIT_PPM, valueCenterX(CO2_SECTION, UNIT_PPM), UNIT_SPACING);
+
+    // Humidity positions
+    constexpr int16_t HUMIDITY_CENTER_X = HUMIDITY_SECTION.centerX;
+    constexpr int16_t HUMIDITY_LABEL_Y = labelBaseline(HUMIDITY_SECTION);
+    constexpr int16_t HUMIDITY_VALUE_Y = valueBaseline(FONT_HUMIDITY, HUMIDITY_SECTION);
+    constexpr Layout::ValueLayout HUMIDITY_LAYOUT = Layout::layoutValue(FONT_HUMIDITY, VALUE_CHARS, FONT_UNIT, UNIT_PERCENT, valueCenterX(HUMIDITY_SECTION, UNIT_PERCENT), UNIT_SPACING);
+
+    // Temperature positions
+    constexpr int16_t TEMPERATURE_CENTER_X = TEMPERATURE_SECTION.centerX;
+    constexpr int16_t TEMPERATURE_LABEL_Y = labelBaseline(TEMPERATURE_SECTION);
+    constexpr int16_t TEMPERATURE_VALUE_Y = valueBaseline(FONT_TEMPERATURE, TEMPERATURE_SECTION);
+    constexpr Layout::ValueLayout TEMPERATURE_LAYOUT = Layout::layoutValue(FONT_TEMPERATURE, VALUE_CHARS, FONT_UNIT, UNIT_CELSIUS, valueCenterX(TEMPERATURE_SECTION, UNIT_CELSIUS), UNIT_SPACING);
+
+    static const uint8_t flash_icon[] = {
+        0x00, 0x80, 0x00, 0x80, 0x01, 0x80, 0x03, 0x80, 0x03, 0x00, 0x07, 0x00, 0x07, 0xf8, 0x0f, 0xf0,
+        0x0f, 0xf0, 0x1f, 0xe0, 0x00, 0xe0, 0x01, 0xc0, 0x01, 0xc0, 0x01, 0x80, 0x01, 0x00, 0x01, 0x00};
+
+    DisplayBuffer *frame = nullptr;        // Frame buffer the current frame is drawn into
+    StaticLayer *staticLayer = nullptr;    // Pre-rendered grid lines and labels
+    const DisplayState *state = nullptr;   // State shown by the current frame
+    const uint8_t *chartHistory = nullptr; // CO2 history drawn by the chart
+    bool showClock = false;                // Flag for showing clock
+    bool captureStaticLayer = false;       // Capture the static layer while the pages of this frame are drawn
+    Rect widgetBounds[WIDGET_COUNT];       // Area covered by each widget in the current frame
+    bool useGlyphBlitter = true;           // Draw text with the glyph blitter, Adafruit GFX is the fallback
+    char stringBuffer[16];                 // Shared string buffer to avoid repeated allocations
+
+    // Grow the bounds of a widget by the given area
+    void extendBounds(Widget widget, int16_t x, int16_t y, uint16_t w, uint16_t h)
+    {
+        Rect area;
+        area.x = x;
+        area.y = y;
+        area.w = w;
+        area.h = h;
+        widgetBounds[widget] = widgetBounds[widget].unite(area);
+    }
+
+    // Print text with its baseline starting at the given position
+    void printText(const char *text, const GFXfont *font, int16_t x, int16_t y)
+    {
+        if (isSegmentFont(font))
+        {
+            drawSegmentText(*frame, font, text, x, y, COLOR_BLACK);
+            return;
+        }
+        if (useGlyphBlitter && blitText(frame->getBuffer(), frame->getStride(), frame->getPageTop(), frame->getPageRows(), font, text, x, y))
+        {
+            return;
+        }
+
+        frame->setFont(font);
+        frame->setTextColor(COLOR_BLACK);
+        frame->setCursor(x, y);
+        frame->print(text);
+    }
+
+    void drawBackground()
+    {
+        // Draw the lines dividing the screen into the sections of the readings
+        for (const Rect &line : GRID_LINES)
+        {
+            frame->fillRect(line.x, line.y, line.w, line.h, COLOR_BLACK);
+        }
+    }
+
+    // Area covered by text centered at the given position
+    Rect getCenteredTextArea(const char *text, const GFXfont *font, uint16_t centerX, uint16_t y)
+    {
+        Layout::Box box = Layout::measure(font, text);
+        Rect area;
+        area.x = centerX - (box.w / 2);
+        area.y = y + box.y;
+        area.w = box.w;
+        area.h = box.h;
+        return area;
+    }
+
+    // Helper function to draw centered text at given position
+    void drawCenteredText(const char *text, const GFXfont *font, uint16_t centerX, uint16_t y)
+    {
+        Layout::Box box = Layout::measure(font, text);
+        int16_t x = centerX - (box.w / 2) - box.x;
+        printText(text, font, x, y);
+    }
+
+    void drawStaticContent()
+    {
+        drawBackground();
+        drawCenteredText(LABEL_CO2, FONT_LABEL, CO2_SECTION.centerX, CO2_LABEL_Y);
+        drawCenteredText(LABEL_HUMIDITY, FONT_LABEL, HUMIDITY_CENTER_X, HUMIDITY_LABEL_Y);
+        drawCenteredText(LABEL_TEMPERATURE, FONT_LABEL, TEMPERATURE_CENTER_X, TEMPERATURE_LABEL_Y);
+    }
+
+    // Reserve the static layer tiles for the grid lines and labels, they are captured while the pages are rendered
+    bool reserveStaticLayer()
+    {
+        Rect areas[] = {
+            GRID_LINES[0],
+            GRID_LINES[1],
+            getCenteredTextArea(LABEL_CO2, FONT_LABEL, CO2_SECTION.centerX, CO2_LABEL_Y),
+            getCenteredTextArea(LABEL_HUMIDITY, FONT_LABEL, HUMIDITY_CENTER_X, HUMIDITY_LABEL_Y),
+            getCenteredTextArea(LABEL_TEMPERATURE, FONT_LABEL, TEMPERATURE_CENTER_X, TEMPERATURE_LABEL_Y),
+        };
+
+        staticLayer->clear();
+        for (const Rect &area : areas)
+        {
+            if (!staticLayer->reserve(area.x, area.y, area.w, area.h))
+            {
+                staticLayer->clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Helper function to draw text with unit, positioned by the number of characters of the value
+    void drawValueWithUnit(Widget widget, const char *valueText, const char *unitText, const GFXfont *valueFont, const Layout::ValueLayout &layout, int16_t y)
+    {
+        size_t cells = std::min<size_t>(strlen(valueText), Layout::MAX_VALUE_CELLS);
+        const Layout::Box &bounds = layout.bounds[cells];
+        extendBounds(widget, bounds.x, y + bounds.y, bounds.w, bounds.h);
+        if (!frame->intersectsPage(y + bounds.y, bounds.h))
+        {
+            return;
+        }
+
+        printText(valueText, valueFont, layout.valueX[cells], y);
+        printText(unitText, FONT_UNIT, layout.unitX[cells], y);
+    }
+
+    void drawHumidity()
+    {
+        snprintf(stringBuffer, sizeof(stringBuffer), "%u", state->humidity / 100);
+        drawValueWithUnit(WIDGET_HUMIDITY, stringBuffer, UNIT_PERCENT, FONT_HUMIDITY, HUMIDITY_LAYOUT, HUMIDITY_VALUE_Y);
+    }
+
+    void drawTemperature()
+    {
+        uint16_t tenths = abs(state->temperature / 10);
+        if (state->temperature < 0)
+        {
+            snprintf(stringBuffer, sizeof(stringBuffer), "-%d.%d", tenths / 10, tenths % 10);
+        }
+        else
+        {
+            snprintf(stringBuffer, sizeof(stringBuffer), "%d.%d", tenths / 10, tenths % 10);
+        }
+        drawValueWithUnit(WIDGET_TEMPERATURE, stringBuffer, UNIT_CELSIUS, FONT_TEMPERATURE, TEMPERATURE_LAYOUT, TEMPERATURE_VALUE_Y);
+    }
+
+    void drawClock(const uint8_t hours, const uint8_t minutes)
+    {
+        extendBounds(WIDGET_CLOCK, CLOCK_BOUNDS.x, CLOCK_BOUNDS.y, CLOCK_BOUNDS.w, CLOCK_BOUNDS.h);
+        if (!frame->intersectsPage(CLOCK_BOUNDS.y, CLOCK_BOUNDS.h))
+        {
+            return;
+        }
+
+        snprintf(stringBuffer, sizeof(stringBuffer), "%02d:%02d", hours, minutes);
+        printText(stringBuffer, FONT_CLOCK, CLOCK_X, CLOCK_Y);
+    }
+
+    void drawBatteryIcon()
+    {
+        uint16_t x = BATTERY_ICON_X;
+        uint16_t y = BATTERY_ICON_Y;
+        extendBounds(WIDGET_BATTERY, x - 16, y, BATTERY_ICON_WIDTH + 4 + 16, 16); // Flash icon to battery tip
+        if (!frame->intersectsPage(y, 16))
+        {
+            return;
+        }
+
+        // Draw a outline of the battery icon
+        frame->fillRect(x, y, BATTERY_ICON_WIDTH, BATTERY_ICON_HEIGHT, COLOR_BLACK);
+        // Draw the battery tip
+        frame->fillRect(x + BATTERY_ICON_WIDTH, y + 4, 4, 8, COLOR_BLACK);
+        // Draw white border inside the battery
+        frame->fillRect(x + 1, y + 1, BATTERY_ICON_WIDTH - 2, BATTERY_ICON_HEIGHT - 2, COLOR_WHITE);
+
+        // Draw battery level indicator
+        frame->fillRect(x + 2, y + 2, Renderer::getBatteryLevelWidth(state->batteryPercent), BATTERY_ICON_HEIGHT - 4, COLOR_BLACK);
+
+        if (state->usbConnected)
+        {
+            // Draw flash_icon
+            frame->drawBitmap(x - 16, y, flash_icon, 16, 16, COLOR_BLACK);
+        }
+    }
+
+    void drawBattery()
+    {
+        drawBatteryIcon();
+    }
+
+    // Draw the history as bars from the bottom of the chart. The columns are drawn in place in a ring: the column
+    // of the newest value moves right on every value and wraps around, the gap in front of it marks the oldest
+    // one. Only a full refresh moves the origin, so every frame draws CHART_COLUMNS bars however old the history is.
+    void drawChart()
+    {
+        extendBounds(WIDGET_CHART, CHART_X, CHART_Y, CHART_COLUMNS, CHART_HEIGHT);
+        if (chartHistory == nullptr || !frame->intersectsPage(CHART_Y, CHART_HEIGHT))
+        {
+            return;
+        }
+
+        for (uint16_t column = 0; column < CHART_COLUMNS; column++)
+        {
+            uint16_t index = (state->chartOrigin + column) % CHART_COLUMNS;
+            if (index == state->chartHead || chartHistory[index] == 0)
+            {
+                continue;
+            }
+
+            uint16_t co2 = std::clamp<int32_t>(chartHistory[index] * CHART_PPM_STEP, CHART_MIN_PPM, CHART_MAX_PPM);
+            int16_t height = 1 + static_cast<uint32_t>(co2 - CHART_MIN_PPM) * (CHART_HEIGHT - 1) / (CHART_MAX_PPM - CHART_MIN_PPM);
+            frame->drawFastVLine(CHART_X + column, CHART_Y + CHART_HEIGHT - height, height, COLOR_BLACK);
+        }
+    }
+
+    void drawCo2()
+    {
+        snprintf(stringBuffer, sizeof(stringBuffer), "%u", state->co2);
+        drawValueWithUnit(WIDGET_CO2, stringBuffer, UNIT_PPM, FONT_CO2, CO2_LAYOUT, CO2_VALUE_Y);
+    }
+}
+
+bool Renderer::beginFrame(DisplayBuffer &frameBuffer, StaticLayer &layer, const DisplayState &displayState, bool clock)
+{
+    frame = &frameBuffer;
+    staticLayer = &layer;
+    state = &displayState;
+    showClock = clock;
+    for (auto &bounds : widgetBounds)
+    {
+        bounds = Rect();
+    }
+
+    captureStaticLayer = false;
+    if (!state->error && !staticLayer->isValid())
+    {
+        captureStaticLayer = reserveStaticLayer();
+        return captureStaticLayer;
+    }
+    return true;
+}
+
+void Renderer::renderPage()
+{
+    frame->fillScreen(COLOR_WHITE);
+    if (state->error)
+    {
+        drawCenteredText("SENSOR", FONT_CO2, DISPLAY_CENTER_X, DISPLAY_CENTER_Y - ERROR_LINE_SPACING);
+        drawCenteredText("ERROR", FONT_CO2, DISPLAY_CENTER_X, DISPLAY_CENTER_Y);
+    }
+    else
+    {
+        // Grid lines and labels come from the static layer
+        if (staticLayer->isValid())
+        {
+            staticLayer->blit(frame->getBuffer(), frame->getStride(), frame->getPageTop(), frame->getPageRows());
+        }
+        else
+        {
+            drawStaticContent();
+            if (captureStaticLayer)
+            {
+                staticLayer->capture(frame->getBuffer(), frame->getStride(), frame->getPageTop(), frame->getPageRows());
+            }
+        }
+
+        // Draw all elements if they have valid values
+        drawCo2();
+        drawTemperature();
+        drawHumidity();
+        drawChart();
+    }
+
+    if (showClock)
+    {
+        drawClock(state->hours, state->minutes);
+    }
+
+    // Always draw battery icon
+    drawBattery();
+}
+
+bool Renderer::endFrame()
+{
+    if (!captureStaticLayer)
+    {
+        return false;
+    }
+    staticLayer->seal();
+    captureStaticLayer = false;
+    return true;
+}
+
+const Rect &Renderer::getBounds(Widget widget)
+{
+    return widgetBounds[widget];
+}
+
+uint16_t Renderer::getBatteryLevelWidth(uint8_t percent)
+{
+    return (BATTERY_ICON_WIDTH - 4) * percent / 100;
+}
+
+void Renderer::setGlyphBlitter(bool enabled)
+{
+    useGlyphBlitter = enabled;
+}
+
+void Renderer::drawWidget(Widget widget)
+{
+    switch (widget)
+    {
+    case WIDGET_CO2:
+        drawCo2();
+        break;
+    case WIDGET_TEMPERATURE:
+        drawTemperature();
+        break;
+    case WIDGET_HUMIDITY:
+        drawHumidity();
+        break;
+    case WIDGET_BATTERY:
+        drawBattery();
+        break;
+    case WIDGET_CLOCK:
+        drawClock(state->hours, state->minutes);
+        break;
+    case WIDGET_CHART:
+        drawChart();
+        break;
+    default:
+        break;
+    }
+}
+
+void Renderer::setChartHistory(const uint8_t *history)
+{
+    chartHistory = history;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <algorithm>
+#include <Adafruit_GFX.h>
+#include "frameBuffer.hpp"
+#include "panelConfig.hpp"
+#include "staticLayer.hpp"
+
+constexpr uint16_t DISPLAY_WIDTH = PanelConfig::WIDTH;   // Width of the screen the layout is made for
+constexpr uint16_t DISPLAY_HEIGHT = PanelConfig::HEIGHT; // Height of the screen the layout is made for
+constexpr uint8_t DISPLAY_ROTATION = 0;                  // Quarter turns of the layout on the panel
+
+// The glyph blitter and the static layer write rows of the frame straight into the buffer
+static_assert(DISPLAY_ROTATION == 0, "The renderer draws unrotated frames only");
+using DisplayBuffer = FrameBuffer<DISPLAY_WIDTH, DISPLAY_HEIGHT, DISPLAY_ROTATION>;
+
+// CO2 history chart, one history value per column. Values are CO2 in steps of CHART_PPM_STEP, 0 marks a column without data.
+constexpr uint16_t CHART_COLUMNS = PanelConfig::STACKED ? 120 : DISPLAY_WIDTH * 3 / 5;
+constexpr uint16_t CHART_PPM_STEP = 20;
+
+enum Widget : uint8_t
+{
+    WIDGET_CO2,
+    WIDGET_TEMPERATURE,
+    WIDGET_HUMIDITY,
+    WIDGET_BATTERY,
+    WIDGET_CLOCK,
+    WIDGET_CHART,
+    WIDGET_COUNT
+};
+
+struct Rect
+{
+    int16_t x = 0;
+    int16_t y = 0;
+    int16_t w = 0;
+    int16_t h = 0;
+
+    bool isEmpty() const
+    {
+        return w <= 0 || h <= 0;
+    }
+
+    // Smallest rectangle containing both rectangles
+    Rect unite(const Rect &other) const
+    {
+        if (isEmpty())
+            return other;
+        if (other.isEmpty())
+            return *this;
+
+        Rect result;
+        result.x = std::min(x, other.x);
+        result.y = std::min(y, other.y);
+        result.w = std::max(x + w, other.x + other.w) - result.x;
+        result.h = std::max(y + h, other.y + other.h) - result.y;
+        return result;
+    }
+
+    // Expand horizontally to whole bytes of the frame buffer and clip to the display
+    Rect alignToBytes() const
+    {
+        Rect result;
+        result.x = std::max<int16_t>(x, 0) & ~7;
+        result.y = std::max<int16_t>(y, 0);
+        result.w = ((std::min<int16_t>(x + w, DISPLAY_WIDTH) + 7) & ~7) - result.x;
+        result.h = std::min<int16_t>(y + h, DISPLAY_HEIGHT) - result.y;
+        return result;
+    }
+};
+
+struct DisplayState
+{
+    uint16_t co2 = 0;
+    int16_t temperature = 0;
+    uint16_t humidity = 0;
+    uint8_t hours = 255;
+    uint8_t minutes = 255;
+    uint8_t batteryPercent = 0; // 0-100, battery percentage
+    bool usbConnected = false;  // USB connection state
+    bool error = false;         // Error State
+    uint16_t chartHead = 0;     // History column written next, drawn as the gap of the chart
+    uint16_t chartOrigin = 0;   // History column drawn at the left edge of the chart
+};
+
+// Draws the air monitor screen into a frame buffer. The renderer knows nothing about the panel or the
+// ESP32 and runs against any DisplayBuffer. A frame is drawn page by page between beginFrame() and
+// endFrame(), the pages can be drawn again after endFrame() as long as the state stays the same.
+namespace Renderer
+{
+    bool beginFrame(DisplayBuffer &frame, StaticLayer &staticLayer, const DisplayState &state, bool showClock); // Start a frame, returns false if the static layer exceeds its budget
+    void renderPage();                              // Draw everything that overlaps the current page of the frame buffer
+    bool endFrame();                                // Finish the first pass over all pages, returns true if the static layer was captured
+    const Rect &getBounds(Widget widget);           // Area covered by a widget, complete once the first page is drawn
+    uint16_t getBatteryLevelWidth(uint8_t percent); // Width of the battery level indicator in pixels
+    void setGlyphBlitter(bool enabled);             // Draw text with the glyph blitter or with Adafruit GFX
+    void drawWidget(Widget widget);                 // Draw a single widget into the current page
+    void setChartHistory(const uint8_t *history);   // Ring of CHART_COLUMNS values drawn by the chart, it has to outlive the frames
+}
@@ -0,0 +1,53 @@
+#include "segmentFont.hpp"
+
+namespace
+{
+    // Draw the segments of a character into its glyph box. Horizontal segments run between the vertical
+    // ones and leave the corners open, which keeps neighbouring segments apart without extra gaps.
+    void drawSegments(Adafruit_GFX &gfx, uint8_t mask, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+    {
+        int16_t t = Segments::getThickness(h);
+        int16_t middle = (h - t) / 2;       // Top of the middle segment
+        int16_t upper = middle - t;         // Length of the upper vertical segments
+        int16_t lower = h - 2 * t - middle; // Length of the lower vertical segments
+
+        if (mask & Segments::A)
+            gfx.fillRect(x + t, y, w - 2 * t, t, color);
+        if (mask & Segments::B)
+            gfx.fillRect(x + w - t, y + t, t, upper, color);
+        if (mask & Segments::C)
+            gfx.fillRect(x + w - t, y + middle + t, t, lower, color);
+        if (mask & Segments::D)
+            gfx.fillRect(x + t, y + h - t, w - 2 * t, t, color);
+        if (mask & Segments::E)
+            gfx.fillRect(x, y + middle + t, t, lower, color);
+        if (mask & Segments::F)
+            gfx.fillRect(x, y + t, t, upper, color);
+        if (mask & Segments::G)
+            gfx.fillRect(x + t, y + middle, w - 2 * t, t, color);
+    }
+}
+
+void drawSegmentText(Adafruit_GFX &gfx, const GFXfont *font, const char *text, int16_t x, int16_t y, uint16_t color)
+{
+    for (; *text; text++)
+    {
+        uint8_t code = static_cast<uint8_t>(*text);
+        if (code < font->first || code > font->last)
+        {
+            continue;
+        }
+
+        const GFXglyph &glyph = font->glyph[code - font->first];
+        uint8_t mask = Segments::getMask(*text);
+        if (mask == Segments::POINT)
+        {
+            gfx.fillRect(x + glyph.xOffset, y + glyph.yOffset, glyph.width, glyph.height, color);
+        }
+        else if (mask != 0)
+        {
+            drawSegments(gfx, mask, x + glyph.xOffset, y + glyph.yOffset, glyph.width, glyph.height, color);
+        }
+        x += glyph.xAdvance;
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <Adafruit_GFX.h>
+
+// Seven segment characters drawn with one filled rectangle per segment instead of a bitmap font.
+// A segment font is a GFXfont without bitmap whose glyphs only carry the metrics, so layout.hpp
+// measures it like the generated fonts and the size is free to choose. Besides the digits, the minus
+// sign and the decimal point it has the letters E, N, O, R and S for the error screen.
+namespace Segments
+{
+    // Segment bits, a is the top segment, then clockwise, g is the middle one
+    constexpr uint8_t A = 0x01, B = 0x02, C = 0x04, D = 0x08, E = 0x10, F = 0x20, G = 0x40;
+    constexpr uint8_t POINT = 0x80; // Decimal point, drawn instead of the segments
+
+    constexpr uint8_t DIGITS[10] = {
+        A | B | C | D | E | F, B | C, A | B | D | E | G, A | B | C | D | G, B | C | F | G,
+        A | C | D | F | G, A | C | D | E | F | G, A | B | C, A | B | C | D | E | F | G, A | B | C | D | F | G};
+
+    constexpr char FIRST = '-';
+    constexpr char LAST = 'S';
+
+    // Segments of a character, 0 for characters without a glyph
+    constexpr uint8_t getMask(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return DIGITS[c - '0'];
+        switch (c)
+        {
+        case '-':
+            return G;
+        case '.':
+            return POINT;
+        case 'E':
+            return A | D | E | F | G;
+        case 'N':
+            return C | E | G;
+        case 'O':
+            return DIGITS[0];
+        case 'R':
+            return E | G;
+        case 'S':
+            return DIGITS[5];
+        default:
+            return 0;
+        }
+    }
+
+    constexpr uint8_t getThickness(uint8_t height)
+    {
+        return height / 8 > 2 ? height / 8 : 2;
+    }
+
+    constexpr uint8_t getWidth(uint8_t height)
+    {
+        return height / 2 + getThickness(height);
+    }
+
+    // Glyph metrics of all characters, every cell is as wide as a digit plus two strokes of spacing
+    template <uint8_t HEIGHT>
+    constexpr std::array<GFXglyph, LAST - FIRST + 1> makeGlyphs()
+    {
+        constexpr uint8_t THICKNESS = getThickness(HEIGHT);
+        constexpr uint8_t WIDTH = getWidth(HEIGHT);
+        constexpr uint8_t ADVANCE = WIDTH + 2 * THICKNESS;
+
+        std::array<GFXglyph, LAST - FIRST + 1> glyphs{};
+        for (char c = FIRST; c <= LAST; c++)
+        {
+            GFXglyph &glyph = glyphs[c - FIRST];
+            glyph.xAdvance = ADVANCE;
+            if (getMask(c) == POINT)
+            {
+                glyph.width = THICKNESS;
+                glyph.height = THICKNESS;
+                glyph.xOffset = (ADVANCE - THICKNESS) / 2;
+                glyph.yOffset = -THICKNESS;
+            }
+            else if (getMask(c) != 0)
+            {
+                glyph.width = WIDTH;
+                glyph.height = HEIGHT;
+                glyph.xOffset = THICKNESS;
+                glyph.yOffset = -HEIGHT;
+            }
+        }
+        return glyphs;
+    }
+}
+
+// Segment font with characters HEIGHT pixels high
+template <uint8_t HEIGHT>
+struct SegmentFont
+{
+    static constexpr std::array<GFXglyph, Segments::LAST - Segments::FIRST + 1> GLYPHS = Segments::makeGlyphs<HEIGHT>();
+    static constexpr GFXfont FONT = {nullptr, const_cast<GFXglyph *>(GLYPHS.data()), Segments::FIRST, Segments::LAST, HEIGHT * 3 / 2};
+};
+
+inline bool isSegmentFont(const GFXfont *font)
+{
+    return font->bitmap == nullptr;
+}
+
+// Draw text of a segment font with its baseline starting at the given position
+void drawSegmentText(Adafruit_GFX &gfx, const GFXfont *font, const char *text, int16_t x, int16_t y, uint16_t color);
@@ -0,0 +1,88 @@
+#include "staticLayer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+bool StaticLayer::isValid() const
+{
+    return mValid;
+}
+
+void StaticLayer::clear()
+{
+    mSize = 0;
+    mTileCount = 0;
+    mValid = false;
+}
+
+bool StaticLayer::reserve(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+    if (w <= 0 || h <= 0 || x < 0 || y < 0)
+    {
+        return false;
+    }
+
+    // Widen the area to whole bytes so rows can be copied without shifting
+    uint8_t xByte = x / 8;
+    uint8_t widthBytes = (x + w + 7) / 8 - xByte;
+    uint16_t bytes = widthBytes * h;
+    if (mTileCount >= MAX_TILES || mSize + bytes > BUDGET)
+    {
+        return false;
+    }
+
+    Tile &tile = mTiles[mTileCount++];
+    tile.offset = mSize;
+    tile.y = y;
+    tile.height = h;
+    tile.xByte = xByte;
+    tile.widthBytes = widthBytes;
+    mSize += bytes;
+    return true;
+}
+
+void StaticLayer::capture(const uint8_t *frame, uint16_t stride, int16_t top, uint16_t rows)
+{
+    for (uint8_t i = 0; i < mTileCount; i++)
+    {
+        const Tile &tile = mTiles[i];
+        int16_t first = std::max<int16_t>(tile.y, top);
+        int16_t last = std::min<int16_t>(tile.y + tile.height, top + rows);
+        if (tile.xByte + tile.widthBytes > stride)
+        {
+            continue;
+        }
+        for (int16_t y = first; y < last; y++)
+        {
+            memcpy(&mData[tile.offset + (y - tile.y) * tile.widthBytes], &frame[(y - top) * stride + tile.xByte], tile.widthBytes);
+        }
+    }
+}
+
+void StaticLayer::seal()
+{
+    mValid = true;
+}
+
+void StaticLayer::blit(uint8_t *frame, uint16_t stride, int16_t top, uint16_t rows) const
+{
+    for (uint8_t i = 0; i < mTileCount; i++)
+    {
+        const Tile &tile = mTiles[i];
+        int16_t first = std::max<int16_t>(tile.y, top);
+        int16_t last = std::min<int16_t>(tile.y + tile.height, top + rows);
+        const uint8_t *src = &mData[tile.offset + (first - tile.y) * tile.widthBytes];
+        uint8_t *dst = &frame[(first - top) * stride + tile.xByte];
+        for (int16_t y = first; y < last; y++)
+        {
+            memcpy(dst, src, tile.widthBytes); // memcpy moves whole words for the aligned part of the row
+            src += tile.widthBytes;
+            dst += stride;
+        }
+    }
+}
+
+uint16_t StaticLayer::size() const
+{
+    return mSize;
+}
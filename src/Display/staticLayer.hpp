@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include "panelConfig.hpp"
+
+// Content that is identical on every update (grid lines, labels), captured once from the
+// frame buffer as byte aligned tiles. Blitting the tiles replaces re-rasterizing the content.
+// Frame buffers holding only a page of rows are supported, tiles are captured and blitted row
+// by row for the part that overlaps the page.
+class StaticLayer
+{
+public:
+    static constexpr uint16_t BUDGET = PanelConfig::STATIC_LAYER_BUDGET; // Maximum number of bytes for all tile data
+    static constexpr uint8_t MAX_TILES = 8;                              // Maximum number of tiles
+
+    bool isValid() const;                                                                // True once all tiles are captured
+    void clear();                                                                        // Drop all tiles
+    bool reserve(int16_t x, int16_t y, int16_t w, int16_t h);                            // Add a tile for an area of the frame, returns false if it does not fit
+    void capture(const uint8_t *frame, uint16_t stride, int16_t top, uint16_t rows);     // Copy the rows top ... top + rows - 1 held by the frame buffer into the tiles
+    void seal();                                                                         // Mark the layer as complete
+    void blit(uint8_t *frame, uint16_t stride, int16_t top, uint16_t rows) const;        // Copy all tiles into the rows held by the frame buffer
+    uint16_t size() const;                                                               // Number of bytes used by tile data
+
+private:
+    struct Tile
+    {
+        uint16_t offset;    // Offset of the tile data in mData
+        uint16_t y;         // First row of the tile
+        uint16_t height;    // Number of rows
+        uint8_t xByte;      // First byte column of the tile
+        uint8_t widthBytes; // Number of bytes per row
+    };
+
+    Tile mTiles[MAX_TILES]; // Tile descriptors
+    uint8_t mData[BUDGET];  // Packed tile rows
+    uint16_t mSize;         // Bytes used in mData
+    uint8_t mTileCount;     // Number of captured tiles
+    bool mValid;            // Set once the layer is complete
+};
@@ -7,9 +7,9 @@ static constexpr uint32_t BAT_EMPTY_VOLTAGE = 3000;      // Empty battery voltag
 static constexpr uint32_t BAT_FULL_VOLTAGE = 4150;       // Full battery voltage in mV
 static constexpr float BAT_VOLTAGE_DIVIDER_RATIO = 4.38; // Voltage divider ratio for battery voltage measurement
 
-void enterSleepMode(uint16_t duration, bool connected)
+void enterSleepMode(uint32_t duration, bool connected)
 {
-    Serial.printf("Entering deep sleep for %d seconds. Enabling wakeup for USB %s...\n", duration, connected ? "disconnection" : "connection");
+    Serial.printf("Entering deep sleep for %lu ms. Enabling wakeup for USB %s...\n", duration, connected ? "disconnection" : "connection");
     Serial.flush(); // Make sure all serial output is sent
 
     rtc_gpio_set_level((gpio_num_t)PIN_RST, HIGH); // Set HIGH for RST pin
@@ -18,7 +18,11 @@ void enterSleepMode(uint16_t duration, bool connected)
     rtc_gpio_set_level((gpio_num_t)PIN_DC, LOW); // Set LOW for DC pin
     rtc_gpio_hold_en((gpio_num_t)PIN_DC);        // Enable hold for the DC pin
 
+#ifdef DISPLAY_SLEEP_DURING_REFRESH
+    rtc_gpio_set_level((gpio_num_t)PIN_CS, HIGH); // Deselect the panel, its controller may still be refreshing
+#else
     rtc_gpio_set_level((gpio_num_t)PIN_CS, LOW); // Set LOW for CS pin
+#endif
     rtc_gpio_hold_en((gpio_num_t)PIN_CS);        // Enable hold for the CS pin
 
     esp_deep_sleep_disable_rom_logging(); // Disable ROM logging to save power
@@ -38,7 +42,7 @@ void enterSleepMode(uint16_t duration, bool connected)
     // Always wake up on BTN
     // esp_sleep_enable_ext1_wakeup(1ULL << PIN_BTN, ESP_EXT1_WAKEUP_ANY_LOW);
 
-    esp_sleep_enable_timer_wakeup(duration * 1000000); // Configure timer wake up
+    esp_sleep_enable_timer_wakeup(duration * 1000ULL); // Configure timer wake up
 
     esp_deep_sleep_start(); // Enter deep sleep
 }
@@ -1,7 +1,7 @@
 #pragma once
 #include <cstdint>
 
-void enterSleepMode(uint16_t duration, bool connected);
+void enterSleepMode(uint32_t duration, bool connected); // Deep sleep for duration in ms or until the USB state changes
 uint32_t readBatteryVoltage();
 uint8_t getBatteryPercentage(uint32_t batteryVoltage = 0);
 
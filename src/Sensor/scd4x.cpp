@@ -0,0 +1,240 @@
+#include "scd4x.hpp"
+#include <Arduino.h>
+#include <array>
+
+namespace
+{
+    // SCD4x commands
+    constexpr uint16_t CMD_MEASURE_SINGLE_SHOT = 0x219D;
+    constexpr uint16_t CMD_MEASURE_SINGLE_SHOT_RHT_ONLY = 0x2196;
+    constexpr uint16_t CMD_READ_MEASUREMENT = 0xEC05;
+    constexpr uint16_t CMD_GET_DATA_READY_STATUS = 0xE4B8;
+    constexpr uint16_t CMD_GET_SERIAL_NUMBER = 0x3682;
+    constexpr uint16_t CMD_GET_SENSOR_VARIANT = 0x202F;
+    constexpr uint16_t CMD_SET_TEMPERATURE_OFFSET = 0x241D;
+    constexpr uint16_t CMD_GET_TEMPERATURE_OFFSET = 0x2318;
+    constexpr uint16_t CMD_GET_SENSOR_ALTITUDE = 0x2322;
+    constexpr uint16_t CMD_SET_AUTOMATIC_SELF_CALIBRATION = 0x2416;
+    constexpr uint16_t CMD_GET_AUTOMATIC_SELF_CALIBRATION = 0x2313;
+    constexpr uint16_t CMD_PERFORM_FORCED_RECALIBRATION = 0x362F;
+    constexpr uint16_t CMD_PERSIST_SETTINGS = 0x3615;
+
+    // Execution times in ms from the datasheet. Single shots run in the background, they are not waited for.
+    constexpr uint16_t READ_TIME = 1;
+    constexpr uint16_t FORCED_RECALIBRATION_TIME = 400;
+    constexpr uint16_t PERSIST_SETTINGS_TIME = 800;
+
+    constexpr uint16_t DATA_READY_MASK = 0x07FF;     // Least significant 11 bits of the data ready status, 0 if no data is ready
+    constexpr uint16_t RECALIBRATION_FAILED = 0xFFFF; // Response of a failed forced recalibration
+    constexpr uint16_t RECALIBRATION_ZERO = 0x8000;   // Response of a forced recalibration without correction
+
+    constexpr uint8_t CRC_POLYNOMIAL = 0x31; // CRC-8 of every response and argument word, x^8 + x^5 + x^4 + 1
+    constexpr uint8_t CRC_INIT = 0xFF;
+
+    constexpr std::array<uint8_t, 256> makeCrcTable()
+    {
+        std::array<uint8_t, 256> table{};
+        for (uint16_t value = 0; value < 256; value++)
+        {
+            uint8_t crc = value;
+            for (uint8_t bit = 0; bit < 8; bit++)
+            {
+                crc = crc & 0x80 ? (crc << 1) ^ CRC_POLYNOMIAL : crc << 1;
+            }
+            table[value] = crc;
+        }
+        return table;
+    }
+
+    constexpr std::array<uint8_t, 256> CRC_TABLE = makeCrcTable();
+
+    uint8_t getCrc(const uint8_t *word)
+    {
+        return CRC_TABLE[CRC_TABLE[CRC_INIT ^ word[0]] ^ word[1]];
+    }
+
+    // Raw values scaled by factor / 65535, the full scale of the sensor's 16 bit values
+    int32_t scale(uint16_t raw, int32_t factor)
+    {
+        return static_cast<int32_t>(raw) * factor / 65535;
+    }
+}
+
+bool Scd4x::begin(int8_t sda, int8_t scl)
+{
+    if (mBus == nullptr)
+    {
+        i2c_master_bus_config_t bus = {};
+        bus.i2c_port = -1; // Any free controller
+        bus.sda_io_num = static_cast<gpio_num_t>(sda);
+        bus.scl_io_num = static_cast<gpio_num_t>(scl);
+        bus.clk_source = I2C_CLK_SRC_DEFAULT;
+        bus.glitch_ignore_cnt = 7;
+        bus.flags.enable_internal_pullup = true;
+        if (i2c_new_master_bus(&bus, &mBus) != ESP_OK)
+        {
+            mBus = nullptr;
+            return false;
+        }
+    }
+
+    if (mDevice == nullptr)
+    {
+        i2c_device_config_t device = {};
+        device.dev_addr_length = I2C_ADDR_BIT_LEN_7;
+        device.device_address = ADDRESS;
+        device.scl_speed_hz = CLOCK_SPEED;
+        if (i2c_master_bus_add_device(mBus, &device, &mDevice) != ESP_OK)
+        {
+            mDevice = nullptr;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Scd4x::measureSingleShot()
+{
+    return sendCommand(CMD_MEASURE_SINGLE_SHOT, 0);
+}
+
+bool Scd4x::measureSingleShotRhtOnly()
+{
+    return sendCommand(CMD_MEASURE_SINGLE_SHOT_RHT_ONLY, 0);
+}
+
+bool Scd4x::readMeasurement(Reading &reading)
+{
+    uint16_t words[3];
+    if (!readWords(CMD_READ_MEASUREMENT, READ_TIME, words, 3))
+        return false;
+
+    reading.co2 = words[0];
+    reading.temperature = scale(words[1], 17500) - 4500; // -45 C ... 130 C
+    reading.humidity = scale(words[2], 10000);           // 0 % ... 100 %
+    return true;
+}
+
+bool Scd4x::getDataReady(bool &ready)
+{
+    uint16_t status;
+    if (!readWords(CMD_GET_DATA_READY_STATUS, READ_TIME, &status, 1))
+        return false;
+
+    ready = (status & DATA_READY_MASK) != 0;
+    return true;
+}
+
+bool Scd4x::getSerialNumber(uint64_t &serial)
+{
+    uint16_t words[3];
+    if (!readWords(CMD_GET_SERIAL_NUMBER, READ_TIME, words, 3))
+        return false;
+
+    serial = static_cast<uint64_t>(words[0]) << 32 | static_cast<uint32_t>(words[1]) << 16 | words[2];
+    return true;
+}
+
+bool Scd4x::getSensorVariant(uint8_t &variant)
+{
+    uint16_t word;
+    if (!readWords(CMD_GET_SENSOR_VARIANT, READ_TIME, &word, 1))
+        return false;
+
+    variant = word >> 12;
+    return true;
+}
+
+bool Scd4x::setTemperatureOffset(int16_t offset)
+{
+    return sendCommand(CMD_SET_TEMPERATURE_OFFSET, static_cast<int32_t>(offset) * 65535 / 17500, READ_TIME);
+}
+
+bool Scd4x::getTemperatureOffset(int16_t &offset)
+{
+    uint16_t word;
+    if (!readWords(CMD_GET_TEMPERATURE_OFFSET, READ_TIME, &word, 1))
+        return false;
+
+    offset = scale(word, 17500);
+    return true;
+}
+
+bool Scd4x::getSensorAltitude(uint16_t &altitude)
+{
+    return readWords(CMD_GET_SENSOR_ALTITUDE, READ_TIME, &altitude, 1);
+}
+
+bool Scd4x::setAutomaticSelfCalibration(bool enabled)
+{
+    return sendCommand(CMD_SET_AUTOMATIC_SELF_CALIBRATION, enabled ? 1 : 0, READ_TIME);
+}
+
+bool Scd4x::getAutomaticSelfCalibration(bool &enabled)
+{
+    uint16_t word;
+    if (!readWords(CMD_GET_AUTOMATIC_SELF_CALIBRATION, READ_TIME, &word, 1))
+        return false;
+
+    enabled = word != 0;
+    return true;
+}
+
+bool Scd4x::performForcedRecalibration(uint16_t co2, int16_t &correction)
+{
+    uint16_t word;
+    if (!sendCommand(CMD_PERFORM_FORCED_RECALIBRATION, co2, FORCED_RECALIBRATION_TIME) || !readResponse(&word, 1) ||
+        word == RECALIBRATION_FAILED)
+        return false;
+
+    correction = static_cast<int32_t>(word) - RECALIBRATION_ZERO;
+    return true;
+}
+
+bool Scd4x::persistSettings()
+{
+    return sendCommand(CMD_PERSIST_SETTINGS, PERSIST_SETTINGS_TIME);
+}
+
+bool Scd4x::sendCommand(uint16_t command, uint16_t executionTime)
+{
+    uint8_t buffer[2] = {static_cast<uint8_t>(command >> 8), static_cast<uint8_t>(command)};
+    if (i2c_master_transmit(mDevice, buffer, sizeof(buffer), TIMEOUT) != ESP_OK)
+        return false;
+
+    delay(executionTime);
+    return true;
+}
+
+bool Scd4x::sendCommand(uint16_t command, uint16_t argument, uint16_t executionTime)
+{
+    uint8_t buffer[5] = {static_cast<uint8_t>(command >> 8), static_cast<uint8_t>(command),
+                         static_cast<uint8_t>(argument >> 8), static_cast<uint8_t>(argument), 0};
+    buffer[4] = getCrc(&buffer[2]);
+    if (i2c_master_transmit(mDevice, buffer, sizeof(buffer), TIMEOUT) != ESP_OK)
+        return false;
+
+    delay(executionTime);
+    return true;
+}
+
+bool Scd4x::readWords(uint16_t command, uint16_t executionTime, uint16_t *words, uint8_t count)
+{
+    return sendCommand(command, executionTime) && readResponse(words, count);
+}
+
+bool Scd4x::readResponse(uint16_t *words, uint8_t count)
+{
+    uint8_t buffer[9];
+    if (count > 3 || i2c_master_receive(mDevice, buffer, count * 3, TIMEOUT) != ESP_OK)
+        return false;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const uint8_t *word = &buffer[i * 3];
+        if (getCrc(word) != word[2])
+            return false;
+        words[i] = word[0] << 8 | word[1];
+    }
+    return true;
+}
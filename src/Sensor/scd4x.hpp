@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <driver/i2c_master.h>
+
+// Driver for the Sensirion SCD40/SCD41 on the ESP-IDF I2C master driver. Only the commands of the idle
+// single shot mode used by the firmware are implemented. Every command is one I2C write, commands with
+// a response are followed by one read of all of its words after the execution time from the datasheet.
+// Values are converted with integer arithmetic, temperature and humidity in 1/100 C and 1/100 %.
+// All functions return false if the sensor does not acknowledge or a response fails its CRC.
+class Scd4x
+{
+public:
+    struct Reading
+    {
+        uint16_t co2;        // CO2 in ppm, not measured by single shots of temperature and humidity only
+        int16_t temperature; // Temperature in C * 100
+        uint16_t humidity;   // Humidity in % * 100
+    };
+
+    bool begin(int8_t sda, int8_t scl);                                 // Set up the I2C bus, the sensor is not accessed
+    bool measureSingleShot();                                           // Start a single shot of CO2, temperature and humidity
+    bool measureSingleShotRhtOnly();                                    // Start a single shot of temperature and humidity only
+    bool readMeasurement(Reading &reading);                             // Read the result of the last measurement, fails while none is ready
+    bool getDataReady(bool &ready);                                     // Check whether a measurement result is ready
+    bool getSerialNumber(uint64_t &serial);                             // 48 bit serial number, also used to probe for the sensor
+    bool getSensorVariant(uint8_t &variant);                            // 0 for the SCD40, 1 for the SCD41
+    bool setTemperatureOffset(int16_t offset);                          // Temperature offset in C * 100
+    bool getTemperatureOffset(int16_t &offset);                         // Temperature offset in C * 100
+    bool getSensorAltitude(uint16_t &altitude);                         // Altitude in m
+    bool setAutomaticSelfCalibration(bool enabled);                     // Automatic self calibration state
+    bool getAutomaticSelfCalibration(bool &enabled);                    // Automatic self calibration state
+    bool performForcedRecalibration(uint16_t co2, int16_t &correction); // Recalibrate to the given CO2 in ppm, correction in ppm
+    bool persistSettings();                                             // Write the settings to the EEPROM of the sensor
+
+private:
+    static constexpr uint8_t ADDRESS = 0x62;
+    static constexpr uint32_t CLOCK_SPEED = 400000; // Fastest clock of the SCD4x in Hz
+    static constexpr int TIMEOUT = 50;              // Longest time in ms for one I2C transfer
+
+    i2c_master_bus_handle_t mBus = nullptr;
+    i2c_master_dev_handle_t mDevice = nullptr;
+
+    bool sendCommand(uint16_t command, uint16_t executionTime);                               // Execution time in ms to wait after the command
+    bool sendCommand(uint16_t command, uint16_t argument, uint16_t executionTime);             // Command with one argument word
+    bool readWords(uint16_t command, uint16_t executionTime, uint16_t *words, uint8_t count); // Command followed by a response of count words
+    bool readResponse(uint16_t *words, uint8_t count);                                        // Read and check a response of up to 3 words
+};
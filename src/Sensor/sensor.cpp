@@ -1,14 +1,20 @@
 #include "sensor.hpp"
-#include "SparkFun_SCD4x_Arduino_Library.h"
+#include "scd4x.hpp"
 #include <Arduino.h>
 #include <Preferences.h>
+#include <time.h>
 
-static SCD4x mySensor;
+static Scd4x scd4x;
 static Preferences preferences;
 static constexpr uint16_t SENSOR_SLOW_SLEEP_TIME = 2400; // Sleep interval time for slow sensor updates in milliseconds
 static constexpr uint16_t SENSOR_FAST_SLEEP_TIME = 20;   // Sleep interval time for fast sensor updates in milliseconds
 RTC_DATA_ATTR static Sensor::Measurement rtcMeasurement; // RTC memory to store sensor measurement data
 RTC_DATA_ATTR static Sensor::Config rtcConfig;           // RTC memory to store sensor configuration
+RTC_DATA_ATTR static Sensor::State rtcState;             // RTC memory to store the measurement in progress
+RTC_DATA_ATTR static uint32_t rtcStartTime;              // RTC memory to store the start time of the measurement in seconds
+RTC_DATA_ATTR static bool rtcWarm;                       // RTC memory to store that the sensor was found and configured
+RTC_DATA_ATTR static uint64_t rtcSerial;                 // RTC memory to store the serial number of the configured sensor
+RTC_DATA_ATTR static uint32_t rtcConfigChecksum;         // RTC memory to store the checksum of the configuration written to the sensor
 
 void getStoredConfig()
 {
@@ -23,6 +29,18 @@ void getStoredConfig()
     preferences.end();
 }
 
+// FNV-1a over the configuration, a changed configuration has to be written to the sensor again
+static uint32_t getConfigChecksum(const Sensor::Config &config)
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&config);
+    uint32_t checksum = 2166136261;
+    for (size_t i = 0; i < sizeof(config); i++)
+    {
+        checksum = (checksum ^ bytes[i]) * 16777619;
+    }
+    return checksum;
+}
+
 static void updateStoredConfig()
 {
     preferences.begin("sensor_config", false);
@@ -34,83 +52,196 @@ static void updateStoredConfig()
 
 bool Sensor::begin(bool rebooted)
 {
-    Wire.begin(PIN_I2C_SDA, PIN_I2C_SCL);
-
-    // Begin measurement mode and disable automatic self-calibration
-    if (mySensor.begin(false, false, true) == false)
+    if (!scd4x.begin(PIN_I2C_SDA, PIN_I2C_SCL))
     {
-        Serial.println("Error: Sensor not detected!");
+        Serial.println("Error: I2C bus not available!");
         mMeasurement.error = true;
+        rtcState = IDLE;
+        rtcWarm = false;
         return false;
     }
 
+    // A measurement left from long ago, for example before a reset, no longer describes the room
+    if (rtcState != IDLE && static_cast<uint32_t>(time(nullptr)) - rtcStartTime > MAX_RESULT_AGE)
+    {
+        Serial.println("Discarding a stale measurement");
+        rtcState = IDLE;
+    }
+
+    // The configuration is read from flash on a cold boot and kept in RTC memory across deep sleep
     if (!rebooted)
     {
         getStoredConfig();
-        scd4x_sensor_type_e sensor;
-        mySensor.getFeatureSetVersion(&sensor);
-        mySensor.setTemperatureOffset(mConfig.temperatureOffset / 100);
-        Serial.printf(
-            "Sensor determined to be of type: SCD4%d Temperature offset is: %.2f Sensor altitude is currently: %d Automatic Self Calibration Enabled: %s\n",
-            sensor,
-            mySensor.getTemperatureOffset(),
-            mySensor.getSensorAltitude(),
-            mySensor.getAutomaticSelfCalibrationEnabled() ? "true" : "false");
+    }
+    mConfig = rtcConfig;
+
+    // On a deep sleep wake the sensor was found and configured before, so the wake goes straight to its
+    // measurement. Cold boots and wakes after an I2C error probe and configure the sensor again.
+    if (rebooted && rtcWarm && rtcConfigChecksum == getConfigChecksum(mConfig))
+    {
+        return true;
+    }
+    rtcWarm = false;
+
+    // The serial number is the cheapest response that shows the sensor is there
+    uint64_t serial;
+    if (!scd4x.getSerialNumber(serial))
+    {
+        Serial.println("Error: Sensor not detected!");
+        mMeasurement.error = true;
+        rtcState = IDLE;
+        return false;
+    }
+
+    if (rebooted)
+    {
+        Serial.printf("Reconfiguring the %s sensor\n", serial == rtcSerial ? "same" : "replaced");
+    }
+
+    // The settings stay in the sensor while it is powered, so they are written again only by a full init
+    uint8_t variant = 0;
+    int16_t offset = 0;
+    uint16_t altitude = 0;
+    bool selfCalibration = false;
+    bool success = scd4x.getSensorVariant(variant);
+    success &= scd4x.setAutomaticSelfCalibration(false);
+    success &= scd4x.setTemperatureOffset(mConfig.temperatureOffset);
+    scd4x.getTemperatureOffset(offset);
+    scd4x.getSensorAltitude(altitude);
+    scd4x.getAutomaticSelfCalibration(selfCalibration);
+    Serial.printf(
+        "Sensor determined to be of type: SCD4%d Serial number: %04x%08lx Temperature offset is: %d.%02d Sensor altitude is currently: %d Automatic Self Calibration Enabled: %s\n",
+        variant,
+        static_cast<unsigned>(serial >> 32), static_cast<uint32_t>(serial),
+        offset / 100, abs(offset % 100),
+        altitude,
+        selfCalibration ? "true" : "false");
+
+    // Only a sensor that took its whole configuration is skipped on the following wakes
+    if (success)
+    {
+        rtcSerial = serial;
+        rtcConfigChecksum = getConfigChecksum(mConfig);
+        rtcWarm = true;
     }
 
     return true;
 }
 
-bool Sensor::updateFast()
+bool Sensor::startUpdateFast()
 {
     Serial.println("Sensor Fast Measurement Requested");
-    if (!mySensor.measureSingleShotRHTOnly())
+    if (!scd4x.measureSingleShotRhtOnly())
     {
         Serial.println("Error: Fast Single Shot Measurement failed!");
         mMeasurement.error = true;
+        rtcWarm = false;
         return false;
     }
 
-    while (mySensor.getDataReadyStatus() == false)
+    rtcState = MEASURING_RHT;
+    rtcStartTime = time(nullptr);
+    return true;
+}
+
+bool Sensor::startUpdate()
+{
+    Serial.println("Sensor Measurement Requested");
+    if (!scd4x.measureSingleShot())
     {
-        Serial.print(".");
-        Serial.flush();
-        esp_sleep_enable_timer_wakeup(SENSOR_FAST_SLEEP_TIME * 1000);
-        esp_light_sleep_start();
+        Serial.println("Error: Single Shot Measurement failed!");
+        mMeasurement.error = true;
+        rtcWarm = false;
+        return false;
     }
 
-    mMeasurement.temperature = mySensor.getTemperature() * 100;
-    mMeasurement.humidity = mySensor.getHumidity() * 100;
-    printMeasurement();
+    rtcState = MEASURING;
+    rtcStartTime = time(nullptr);
     return true;
 }
 
-bool Sensor::update()
+bool Sensor::finishUpdate()
 {
-    Serial.print("Sensor Measurement Requested ");
-    if (!mySensor.measureSingleShot())
+    State state = rtcState;
+    rtcState = IDLE;
+    if (state == IDLE)
     {
-        Serial.println("Error: Single Shot Measurement failed!");
-        mMeasurement.error = true;
         return false;
     }
 
-    while (mySensor.getDataReadyStatus() == false)
+    // After a deep sleep of the conversion time the result is ready at once and read without asking.
+    // The sensor does not acknowledge the read while no result is ready, then sleep until it is.
+    // A sensor that stops answering is given up on after a whole conversion time and a margin.
+    uint16_t sleepTime = state == MEASURING ? SENSOR_SLOW_SLEEP_TIME : SENSOR_FAST_SLEEP_TIME;
+    uint32_t maxWait = (state == MEASURING ? CONVERSION_TIME : CONVERSION_TIME_RHT) + MAX_WAIT_MARGIN;
+    Scd4x::Reading reading;
+    if (!scd4x.readMeasurement(reading))
     {
-        Serial.print(".");
-        Serial.flush();
-        esp_sleep_enable_timer_wakeup(SENSOR_SLOW_SLEEP_TIME * 1000);
-        esp_light_sleep_start();
+        Serial.print("Waiting for the sensor");
+        uint32_t waitStart = millis();
+        bool ready = false;
+        do
+        {
+            if (millis() - waitStart >= maxWait)
+            {
+                Serial.println();
+                Serial.println("Error: Sensor measurement timed out!");
+                mMeasurement.error = true;
+                rtcWarm = false;
+                return false;
+            }
+            Serial.print(".");
+            Serial.flush();
+            esp_sleep_enable_timer_wakeup(sleepTime * 1000);
+            esp_light_sleep_start();
+            if (!scd4x.getDataReady(ready))
+            {
+                ready = false;
+            }
+        } while (!ready);
+        Serial.println();
+
+        if (!scd4x.readMeasurement(reading))
+        {
+            Serial.println("Error: Reading the measurement failed!");
+            mMeasurement.error = true;
+            rtcWarm = false;
+            return false;
+        }
     }
-    Serial.println();
 
-    mMeasurement.co2 = mySensor.getCO2();
-    mMeasurement.temperature = mySensor.getTemperature() * 100;
-    mMeasurement.humidity = mySensor.getHumidity() * 100;
+    // A measurement started before deep sleep shows the room as it was one wake interval ago
+    Serial.printf("Measurement started %lu s ago\n", static_cast<uint32_t>(time(nullptr)) - rtcStartTime);
+    if (state == MEASURING)
+    {
+        mMeasurement.co2 = reading.co2;
+    }
+    mMeasurement.temperature = reading.temperature;
+    mMeasurement.humidity = reading.humidity;
     printMeasurement();
     return true;
 }
 
+bool Sensor::updateFast()
+{
+    return startUpdateFast() && finishUpdate();
+}
+
+bool Sensor::update()
+{
+    return startUpdate() && finishUpdate();
+}
+
+bool Sensor::isMeasuring() const
+{
+    return rtcState != IDLE;
+}
+
+uint32_t Sensor::getConversionTime() const
+{
+    return rtcState == MEASURING ? CONVERSION_TIME : CONVERSION_TIME_RHT;
+}
+
 Sensor::Config Sensor::getConfig() const
 {
     return mConfig;
@@ -123,19 +254,19 @@ Sensor::Measurement Sensor::getMeasurement() const
 
 void Sensor::startFRC()
 {
-    float correction;
+    int16_t correction = 0;
     printf("Starting FRC with value: %d\n", mConfig.frcValue);
-    mySensor.performForcedRecalibration(mConfig.frcValue, &correction);
-    mySensor.persistSettings();
-    printf("FRC completed. Correction value: %.2f\n", correction);
+    scd4x.performForcedRecalibration(mConfig.frcValue, correction);
+    scd4x.persistSettings();
+    printf("FRC completed. Correction value: %d\n", correction);
     delay(500);
     ESP.restart();
 }
 
 void Sensor::printMeasurement() const
 {
-    Serial.printf("CO2: %d, Temperature: %d.%02d, Humidity: %d.%02d\n",
+    Serial.printf("CO2: %d, Temperature: %s%d.%02d, Humidity: %d.%02d\n",
                   mMeasurement.co2,
-                  mMeasurement.temperature / 100, abs(mMeasurement.temperature % 100),
+                  mMeasurement.temperature < 0 ? "-" : "", abs(mMeasurement.temperature / 100), abs(mMeasurement.temperature % 100),
                   mMeasurement.humidity / 100, abs(mMeasurement.humidity % 100));
 }
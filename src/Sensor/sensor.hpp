@@ -7,7 +7,7 @@ public:
     struct Measurement
     {
         uint16_t co2;         // CO2 value in PPM
-        uint16_t temperature; // Temperature in C * 100
+        int16_t temperature;  // Temperature in C * 100
         uint16_t humidity;    // Humidity in % * 100
         bool error;           // Error flag
     };
@@ -19,10 +19,23 @@ public:
         uint16_t frcValue;         // FRC value
     };
 
+    // Measurement the sensor is running, kept in RTC memory so a deep sleep can pass while it converts
+    enum State : uint8_t
+    {
+        IDLE,
+        MEASURING,    // Single shot of CO2, temperature and humidity
+        MEASURING_RHT // Single shot of temperature and humidity only
+    };
+
     Sensor() = default;                                 // Constructor
     bool begin(bool rebooted);                          // Start the sensor and return true if it was detected
+    bool startUpdateFast();                             // Start measuring only temperature and humidity, returns false on an error
+    bool startUpdate();                                 // Start measuring all values, returns false on an error
+    bool finishUpdate();                                // Read the started measurement, waits for the rest of its conversion. Returns true if new values are available
     bool updateFast();                                  // Update only temperature and humidity, returns true if new values are available
     bool update();                                      // Update the sensor values, returns true if new values are available
+    bool isMeasuring() const;                           // A measurement was started and not read yet, possibly before a deep sleep
+    uint32_t getConversionTime() const;                 // Time in ms the started measurement takes
     Config getConfig() const;                           // Get the current sensor configuration
     Measurement getMeasurement() const;                 // Get the latest measurement values
     void startFRC();                                    // Start the forced recalibration
@@ -33,6 +46,12 @@ private:
     static constexpr uint16_t STARTUP_TIME_H = 90;  // Startup time in seconds (Humidity)
     static constexpr uint16_t STARTUP_TIME_T = 120; // Startup time in seconds (Temperature)
 
+    // Single shot conversion times from the datasheet
+    static constexpr uint32_t CONVERSION_TIME = 5000;   // Conversion time in milliseconds (CO2)
+    static constexpr uint32_t CONVERSION_TIME_RHT = 50; // Conversion time in milliseconds (Temperature and humidity only)
+    static constexpr uint32_t MAX_RESULT_AGE = 600;     // Results of measurements started longer ago in seconds are discarded
+    static constexpr uint32_t MAX_WAIT_MARGIN = 1000;   // Time in ms past the conversion time to wait for a result before giving up
+
     unsigned long mSensorStartupTime = 0; // Sensor startup time
     Measurement mMeasurement{};           // Current measurement values
     Config mConfig{};                     // Sensor configuration
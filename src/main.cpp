@@ -11,14 +11,18 @@ struct RtcData
 {
   uint16_t co2Value = 0;         // CO2 value in PPM
   uint16_t humidityValue = 0;    // Humidity value in % * 100
-  uint16_t temperatureValue = 0; // Temperature value in C * 100
+  int16_t temperatureValue = 0;  // Temperature value in C * 100
   uint16_t batteryVoltage = 0;   // Battery voltage in mV (smoothed)
   uint8_t batteryPercent = 0;    // Battery percentage (smoothed)
   uint16_t wakeCount = 0;        // Wake count to track deep sleep cycles
+  uint32_t cycleAwakeTime = 0;   // Awake time in ms of the wake that started the sensor measurement
+  bool coldStart = false;        // The measurement cycle started with a first boot, the panel needs a full refresh
+  bool conversionWake = false;   // The last deep sleep waited for a sensor conversion of the same cycle
 };
 
-static constexpr uint32_t DEEP_SLEEP_DURATION = 60;           // Deep sleep duration in seconds
-static constexpr uint32_t DEEP_SLEEP_DURATION_CONNECTED = 30; // Deep sleep duration when USB is connected
+static constexpr uint32_t DEEP_SLEEP_DURATION = 60000;           // Deep sleep duration in ms
+static constexpr uint32_t DEEP_SLEEP_DURATION_CONNECTED = 30000; // Deep sleep duration in ms when USB is connected
+static constexpr uint32_t SENSOR_DEEP_SLEEP_FROM = 1000;         // Sensor conversions from this length in ms are spent in deep sleep, shorter ones cost less than a wake
 RTC_DATA_ATTR RtcData rtcData{};
 Sensor sensor;
 
@@ -50,20 +54,16 @@ bool getUsbConnected()
   return digitalRead(PIN_USB_DETECT);
 }
 
-void batteryMode(bool reboot)
+// Start the measurement for the wake with the given count. With USB every wake measures CO2.
+void startMeasurement(bool usbConnected, uint16_t wakeCount)
 {
-  if (reboot)
-  {
-    rtcData.wakeCount++;
-  }
-
-  if (rtcData.wakeCount % 5 == 0)
+  if (usbConnected || wakeCount % 5 == 0)
   {
-    sensor.update(); // Every 5th wake, perform a full sensor update
+    sensor.startUpdate(); // Every 5th wake, perform a full sensor update
   }
   else
   {
-    sensor.updateFast(); // Fast update for temperature and humidity only
+    sensor.startUpdateFast(); // Fast update for temperature and humidity only
   }
 }
 
@@ -74,6 +74,10 @@ void setup()
 
   initGpio(); // Initialize GPIO pins
 
+#ifdef DISPLAY_BENCHMARK
+  runDisplayBenchmark();
+#endif
+
   bool reboot = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER || esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_EXT1;
   if (reboot)
   {
@@ -82,20 +86,38 @@ void setup()
   else
   {
     Serial.println("First boot, initializing sensor...");
+    rtcData.coldStart = true;
   }
   sensor.begin(reboot);
 
   bool usbConnected = getUsbConnected();
-  if (usbConnected)
+  bool conversionWake = rtcData.conversionWake;
+  rtcData.conversionWake = false;
+  Serial.println(usbConnected ? "USB is connected" : "USB is not connected, entering battery mode...");
+  if (!usbConnected && reboot && !conversionWake)
   {
-    Serial.println("USB is connected");
-    sensor.update();
+    rtcData.wakeCount++;
+  }
+
+  // The measurement is normally started at the end of the previous wake and converted during its deep sleep.
+  // A measurement of the other kind, after the USB state changed, is taken as it is.
+  if (sensor.isMeasuring())
+  {
+    Serial.println(conversionWake ? "Resuming the sensor measurement" : "Reading the measurement started before deep sleep");
   }
   else
   {
-    Serial.println("USB is not connected, entering battery mode...");
-    batteryMode(reboot);
+    startMeasurement(usbConnected, rtcData.wakeCount);
+
+    // Sleep through a long conversion, the next wake continues with reading the result
+    if (sensor.isMeasuring() && sensor.getConversionTime() >= SENSOR_DEEP_SLEEP_FROM)
+    {
+      rtcData.cycleAwakeTime = millis();
+      rtcData.conversionWake = true;
+      enterSleepMode(sensor.getConversionTime(), usbConnected);
+    }
   }
+  sensor.finishUpdate();
   auto measurement = sensor.getMeasurement();
   if (measurement.co2 > 0)
   {
@@ -108,19 +130,25 @@ void setup()
   rtcData.batteryVoltage = smoothValue<uint16_t>(readBatteryVoltage(), rtcData.batteryVoltage);
   rtcData.batteryPercent = getBatteryPercentage(rtcData.batteryVoltage);
 
-  bleInit();
-  bleUpdatePayload(rtcData.humidityValue, rtcData.temperatureValue, rtcData.co2Value, rtcData.batteryVoltage, rtcData.batteryPercent);
-
   setUSBConnected(usbConnected);
   setBatteryPercent(rtcData.batteryPercent);
   setCo2Value(rtcData.co2Value);
   setErrorState(measurement.error);
   setHumidityValue(rtcData.humidityValue);
   setTemperatureValue(rtcData.temperatureValue);
-  setUSBConnected(false);
-  updateDisplay(reboot);
+  startDisplayUpdate(!rtcData.coldStart); // The panel refreshes while BLE is brought up and advertises
+  rtcData.coldStart = false;
 
+  bleInit();
+  bleUpdatePayload(rtcData.humidityValue, rtcData.temperatureValue, rtcData.co2Value, rtcData.batteryVoltage, rtcData.batteryPercent);
+
+  finishDisplayUpdate();
   bleStopAdvertising();
+
+  // Start the measurement of the next wake, the sensor converts it while the device sleeps
+  startMeasurement(usbConnected, usbConnected ? rtcData.wakeCount : rtcData.wakeCount + 1);
+  Serial.printf("Awake for %lu ms, %lu ms in this measurement cycle\n", millis(), rtcData.cycleAwakeTime + millis());
+  rtcData.cycleAwakeTime = 0;
   enterSleepMode(usbConnected ? DEEP_SLEEP_DURATION_CONNECTED : DEEP_SLEEP_DURATION, usbConnected);
 }
 
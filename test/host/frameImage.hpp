@@ -0,0 +1,128 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Frames of the 1 bit frame buffer (MSB first, 1 = white) as image files. PBM (P4) is the format of the golden
+// frames, its bits are inverted (1 = black). PNG is written for viewing, 1 bit grayscale in stored deflate
+// blocks, which needs neither zlib nor an encoder.
+namespace FrameImage
+{
+    inline bool writePbm(const char *path, const uint8_t *frame, uint16_t width, uint16_t height)
+    {
+        FILE *file = fopen(path, "wb");
+        if (file == nullptr)
+            return false;
+
+        fprintf(file, "P4\n%u %u\n", width, height);
+        for (uint32_t i = 0; i < static_cast<uint32_t>(width + 7) / 8 * height; i++)
+        {
+            fputc(static_cast<uint8_t>(~frame[i]), file);
+        }
+        return fclose(file) == 0;
+    }
+
+    // Read a PBM written by writePbm(), returns false if it is missing or of another size
+    inline bool readPbm(const char *path, std::vector<uint8_t> &frame, uint16_t width, uint16_t height)
+    {
+        FILE *file = fopen(path, "rb");
+        if (file == nullptr)
+            return false;
+
+        unsigned fileWidth = 0;
+        unsigned fileHeight = 0;
+        bool valid = fscanf(file, "P4 %u %u", &fileWidth, &fileHeight) == 2 && fgetc(file) == '\n' &&
+                     fileWidth == width && fileHeight == height;
+        frame.resize(static_cast<uint32_t>(width + 7) / 8 * height);
+        valid = valid && fread(frame.data(), 1, frame.size(), file) == frame.size();
+        fclose(file);
+        for (uint8_t &byte : frame)
+        {
+            byte = ~byte;
+        }
+        return valid;
+    }
+
+    namespace Png
+    {
+        inline uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0)
+        {
+            crc = ~crc;
+            for (size_t i = 0; i < size; i++)
+            {
+                crc ^= data[i];
+                for (uint8_t bit = 0; bit < 8; bit++)
+                {
+                    crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+                }
+            }
+            return ~crc;
+        }
+
+        inline void putWord(std::vector<uint8_t> &out, uint32_t value)
+        {
+            for (int shift = 24; shift >= 0; shift -= 8)
+            {
+                out.push_back(value >> shift);
+            }
+        }
+
+        inline void putChunk(FILE *file, const char *type, const std::vector<uint8_t> &data)
+        {
+            std::vector<uint8_t> chunk(type, type + 4);
+            chunk.insert(chunk.end(), data.begin(), data.end());
+            std::vector<uint8_t> header;
+            putWord(header, data.size());
+            fwrite(header.data(), 1, header.size(), file);
+            fwrite(chunk.data(), 1, chunk.size(), file);
+            std::vector<uint8_t> crc;
+            putWord(crc, crc32(chunk.data(), chunk.size()));
+            fwrite(crc.data(), 1, crc.size(), file);
+        }
+    }
+
+    inline bool writePng(const char *path, const uint8_t *frame, uint16_t width, uint16_t height)
+    {
+        FILE *file = fopen(path, "wb");
+        if (file == nullptr)
+            return false;
+
+        static const uint8_t SIGNATURE[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        fwrite(SIGNATURE, 1, sizeof(SIGNATURE), file);
+
+        std::vector<uint8_t> header;
+        Png::putWord(header, width);
+        Png::putWord(header, height);
+        header.insert(header.end(), {1, 0, 0, 0, 0}); // 1 bit grayscale, 0 is black like in the frame buffer
+        Png::putChunk(file, "IHDR", header);
+
+        // Rows with filter type 0, wrapped in zlib stored blocks of at most 65535 bytes
+        uint16_t stride = (width + 7) / 8;
+        std::vector<uint8_t> raw;
+        for (uint16_t y = 0; y < height; y++)
+        {
+            raw.push_back(0);
+            raw.insert(raw.end(), &frame[y * stride], &frame[(y + 1) * stride]);
+        }
+        std::vector<uint8_t> data = {0x78, 0x01};
+        for (size_t offset = 0; offset < raw.size() || offset == 0; offset += 65535)
+        {
+            uint16_t size = raw.size() - offset < 65535 ? raw.size() - offset : 65535;
+            data.insert(data.end(), {static_cast<uint8_t>(offset + size == raw.size()), static_cast<uint8_t>(size),
+                                     static_cast<uint8_t>(size >> 8), static_cast<uint8_t>(~size),
+                                     static_cast<uint8_t>(~size >> 8)});
+            data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + size);
+        }
+        uint32_t a = 1;
+        uint32_t b = 0;
+        for (uint8_t byte : raw)
+        {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        Png::putWord(data, b << 16 | a);
+        Png::putChunk(file, "IDAT", data);
+        Png::putChunk(file, "IEND", {});
+        return fclose(file) == 0;
+    }
+}
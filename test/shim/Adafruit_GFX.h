@@ -0,0 +1,426 @@
+#pragma once
+#include <Arduino.h>
+#include <utility>
+
+// The parts of Adafruit GFX used by the renderer, for the host build in [env:native]. The drawing code
+// follows Adafruit GFX 1.11, including the per pixel paths of text and bitmaps and the GFXcanvas1 line
+// fills, so host frames and benchmarks behave like the library on the device.
+
+struct GFXglyph
+{
+    uint16_t bitmapOffset;
+    uint8_t width;
+    uint8_t height;
+    uint8_t xAdvance;
+    int8_t xOffset;
+    int8_t yOffset;
+};
+
+struct GFXfont
+{
+    uint8_t *bitmap;
+    GFXglyph *glyph;
+    uint16_t first;
+    uint16_t last;
+    uint8_t yAdvance;
+};
+
+class Adafruit_GFX : public Print
+{
+public:
+    Adafruit_GFX(int16_t w, int16_t h) : WIDTH(w), HEIGHT(h), _width(w), _height(h)
+    {
+    }
+
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+    virtual void startWrite()
+    {
+    }
+
+    virtual void writePixel(int16_t x, int16_t y, uint16_t color)
+    {
+        drawPixel(x, y, color);
+    }
+
+    virtual void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+    {
+        fillRect(x, y, w, h, color);
+    }
+
+    virtual void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+    {
+        drawFastVLine(x, y, h, color);
+    }
+
+    virtual void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+    {
+        drawFastHLine(x, y, w, color);
+    }
+
+    virtual void writeLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
+    {
+        bool steep = abs(y1 - y0) > abs(x1 - x0);
+        if (steep)
+        {
+            std::swap(x0, y0);
+            std::swap(x1, y1);
+        }
+        if (x0 > x1)
+        {
+            std::swap(x0, x1);
+            std::swap(y0, y1);
+        }
+
+        int16_t dx = x1 - x0;
+        int16_t dy = abs(y1 - y0);
+        int16_t err = dx / 2;
+        int16_t ystep = y0 < y1 ? 1 : -1;
+        for (; x0 <= x1; x0++)
+        {
+            if (steep)
+                writePixel(y0, x0, color);
+            else
+                writePixel(x0, y0, color);
+            err -= dy;
+            if (err < 0)
+            {
+                y0 += ystep;
+                err += dx;
+            }
+        }
+    }
+
+    virtual void endWrite()
+    {
+    }
+
+    virtual void setRotation(uint8_t r)
+    {
+        rotation = r & 3;
+        _width = rotation & 1 ? HEIGHT : WIDTH;
+        _height = rotation & 1 ? WIDTH : HEIGHT;
+    }
+
+    virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+    {
+        writeLine(x, y, x, y + h - 1, color);
+    }
+
+    virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+    {
+        writeLine(x, y, x + w - 1, y, color);
+    }
+
+    virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+    {
+        for (int16_t i = x; i < x + w; i++)
+        {
+            writeFastVLine(i, y, h, color);
+        }
+    }
+
+    virtual void fillScreen(uint16_t color)
+    {
+        fillRect(0, 0, _width, _height, color);
+    }
+
+    void drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[], int16_t w, int16_t h, uint16_t color)
+    {
+        int16_t byteWidth = (w + 7) / 8;
+        uint8_t b = 0;
+        for (int16_t j = 0; j < h; j++, y++)
+        {
+            for (int16_t i = 0; i < w; i++)
+            {
+                if (i & 7)
+                    b <<= 1;
+                else
+                    b = pgm_read_byte(&bitmap[j * byteWidth + i / 8]);
+                if (b & 0x80)
+                    writePixel(x + i, y, color);
+            }
+        }
+    }
+
+    // Custom fonts at text size 1 only
+    void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color)
+    {
+        const GFXglyph *glyph = &gfxFont->glyph[c - gfxFont->first];
+        const uint8_t *bitmap = gfxFont->bitmap;
+        uint16_t offset = glyph->bitmapOffset;
+        uint8_t bits = 0;
+        uint8_t bit = 0;
+        for (uint8_t yy = 0; yy < glyph->height; yy++)
+        {
+            for (uint8_t xx = 0; xx < glyph->width; xx++)
+            {
+                if (!(bit++ & 7))
+                    bits = pgm_read_byte(&bitmap[offset++]);
+                if (bits & 0x80)
+                    writePixel(x + glyph->xOffset + xx, y + glyph->yOffset + yy, color);
+                bits <<= 1;
+            }
+        }
+    }
+
+    size_t write(uint8_t c) override
+    {
+        if (c == '\n')
+        {
+            cursor_x = 0;
+            cursor_y += gfxFont->yAdvance;
+        }
+        else if (c != '\r' && c >= gfxFont->first && c <= gfxFont->last)
+        {
+            const GFXglyph *glyph = &gfxFont->glyph[c - gfxFont->first];
+            if (glyph->width > 0 && glyph->height > 0)
+            {
+                if (wrap && cursor_x + glyph->xOffset + glyph->width > _width)
+                {
+                    cursor_x = 0;
+                    cursor_y += gfxFont->yAdvance;
+                }
+                drawChar(cursor_x, cursor_y, c, textcolor);
+            }
+            cursor_x += glyph->xAdvance;
+        }
+        return 1;
+    }
+
+    void setFont(const GFXfont *font)
+    {
+        gfxFont = const_cast<GFXfont *>(font);
+    }
+
+    void setCursor(int16_t x, int16_t y)
+    {
+        cursor_x = x;
+        cursor_y = y;
+    }
+
+    void setTextColor(uint16_t color)
+    {
+        textcolor = color;
+    }
+
+    void setTextWrap(bool enabled)
+    {
+        wrap = enabled;
+    }
+
+    int16_t width() const
+    {
+        return _width;
+    }
+
+    int16_t height() const
+    {
+        return _height;
+    }
+
+    uint8_t getRotation() const
+    {
+        return rotation;
+    }
+
+protected:
+    const int16_t WIDTH;
+    const int16_t HEIGHT;
+    int16_t _width;
+    int16_t _height;
+    int16_t cursor_x = 0;
+    int16_t cursor_y = 0;
+    uint16_t textcolor = 0xFFFF;
+    uint8_t rotation = 0;
+    bool wrap = true;
+    GFXfont *gfxFont = nullptr;
+};
+
+// 1 bit canvas with the rotation switch per pixel and the line fills of Adafruit GFX 1.11
+class GFXcanvas1 : public Adafruit_GFX
+{
+public:
+    GFXcanvas1(uint16_t w, uint16_t h) : Adafruit_GFX(w, h)
+    {
+        buffer = static_cast<uint8_t *>(calloc((w + 7) / 8 * h, 1));
+    }
+
+    ~GFXcanvas1()
+    {
+        free(buffer);
+    }
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override
+    {
+        if (buffer == nullptr || x < 0 || y < 0 || x >= _width || y >= _height)
+            return;
+
+        int16_t t;
+        switch (rotation)
+        {
+        case 1:
+            t = x;
+            x = WIDTH - 1 - y;
+            y = t;
+            break;
+        case 2:
+            x = WIDTH - 1 - x;
+            y = HEIGHT - 1 - y;
+            break;
+        case 3:
+            t = x;
+            x = y;
+            y = HEIGHT - 1 - t;
+            break;
+        }
+
+        uint8_t *ptr = &buffer[(x / 8) + y * ((WIDTH + 7) / 8)];
+        if (color)
+            *ptr |= 0x80 >> (x & 7);
+        else
+            *ptr &= ~(0x80 >> (x & 7));
+    }
+
+    void fillScreen(uint16_t color) override
+    {
+        if (buffer != nullptr)
+            memset(buffer, color ? 0xFF : 0x00, (WIDTH + 7) / 8 * HEIGHT);
+    }
+
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override
+    {
+        if (h < 0)
+        {
+            h = -h;
+            y -= h - 1;
+        }
+        if (x < 0 || x >= _width || y >= _height || y + h - 1 < 0)
+            return;
+        if (y < 0)
+        {
+            h += y;
+            y = 0;
+        }
+        if (y + h > _height)
+            h = _height - y;
+
+        int16_t t;
+        switch (rotation)
+        {
+        case 0:
+            drawFastRawVLine(x, y, h, color);
+            break;
+        case 1:
+            t = x;
+            x = WIDTH - 1 - y;
+            y = t;
+            drawFastRawHLine(x - (h - 1), y, h, color);
+            break;
+        case 2:
+            drawFastRawVLine(WIDTH - 1 - x, HEIGHT - 1 - y - (h - 1), h, color);
+            break;
+        default:
+            t = x;
+            x = y;
+            y = HEIGHT - 1 - t;
+            drawFastRawHLine(x, y, h, color);
+            break;
+        }
+    }
+
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override
+    {
+        if (w < 0)
+        {
+            w = -w;
+            x -= w - 1;
+        }
+        if (y < 0 || y >= _height || x >= _width || x + w - 1 < 0)
+            return;
+        if (x < 0)
+        {
+            w += x;
+            x = 0;
+        }
+        if (x + w > _width)
+            w = _width - x;
+
+        int16_t t;
+        switch (rotation)
+        {
+        case 0:
+            drawFastRawHLine(x, y, w, color);
+            break;
+        case 1:
+            t = x;
+            x = WIDTH - 1 - y;
+            y = t;
+            drawFastRawVLine(x, y, w, color);
+            break;
+        case 2:
+            drawFastRawHLine(WIDTH - 1 - x - (w - 1), HEIGHT - 1 - y, w, color);
+            break;
+        default:
+            t = x;
+            x = y;
+            y = HEIGHT - 1 - t;
+            drawFastRawVLine(x, y - (w - 1), w, color);
+            break;
+        }
+    }
+
+    uint8_t *getBuffer() const
+    {
+        return buffer;
+    }
+
+private:
+    uint8_t *buffer;
+
+    void drawFastRawVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+    {
+        int16_t rowBytes = (WIDTH + 7) / 8;
+        uint8_t *ptr = &buffer[(x / 8) + y * rowBytes];
+        uint8_t mask = 0x80 >> (x & 7);
+        for (int16_t i = 0; i < h; i++, ptr += rowBytes)
+        {
+            if (color)
+                *ptr |= mask;
+            else
+                *ptr &= ~mask;
+        }
+    }
+
+    void drawFastRawHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+    {
+        uint8_t *ptr = &buffer[(x / 8) + y * ((WIDTH + 7) / 8)];
+        size_t remaining = w;
+        if ((x & 7) > 0)
+        {
+            uint8_t mask = 0;
+            for (int8_t i = x & 7; i < 8 && remaining > 0; i++, remaining--)
+                mask |= 0x80 >> i;
+            if (color)
+                *ptr |= mask;
+            else
+                *ptr &= ~mask;
+            ptr++;
+        }
+        if (remaining > 0)
+        {
+            memset(ptr, color ? 0xFF : 0x00, remaining / 8);
+            ptr += remaining / 8;
+        }
+        if (remaining % 8 > 0)
+        {
+            uint8_t mask = 0;
+            for (size_t i = 0; i < remaining % 8; i++)
+                mask |= 0x80 >> i;
+            if (color)
+                *ptr |= mask;
+            else
+                *ptr &= ~mask;
+        }
+    }
+};
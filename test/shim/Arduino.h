@@ -0,0 +1,52 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// The parts of the Arduino core used by the sources built for [env:native]. Fonts are plain arrays on the
+// host, delay() does not sleep but adds up the requested time, so tests can check it without waiting.
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*reinterpret_cast<const uint8_t *>(addr))
+#define pgm_read_word(addr) (*reinterpret_cast<const uint16_t *>(addr))
+#define pgm_read_pointer(addr) (*(addr))
+
+namespace Shim
+{
+    inline uint32_t delayed = 0; // Sum of all delay() calls in ms
+}
+
+inline uint32_t micros()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline uint32_t millis()
+{
+    return micros() / 1000;
+}
+
+inline void delay(uint32_t ms)
+{
+    Shim::delayed += ms;
+}
+
+class Print
+{
+public:
+    virtual ~Print() = default;
+    virtual size_t write(uint8_t c) = 0;
+
+    size_t print(const char *text)
+    {
+        size_t n = 0;
+        while (*text)
+        {
+            n += write(*text++);
+        }
+        return n;
+    }
+};
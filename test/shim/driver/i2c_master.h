@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Host mock of the ESP-IDF I2C master driver for [env:native]. The bus has a single device, every transfer is
+// handed to the I2cMock::Device installed by the test, which answers like the chip it models.
+
+typedef int esp_err_t;
+constexpr esp_err_t ESP_OK = 0;
+constexpr esp_err_t ESP_FAIL = -1;
+
+typedef int gpio_num_t;
+typedef int i2c_port_num_t;
+typedef struct i2c_bus *i2c_master_bus_handle_t;
+typedef struct i2c_dev *i2c_master_dev_handle_t;
+
+enum i2c_clock_source_t
+{
+    I2C_CLK_SRC_DEFAULT
+};
+
+enum i2c_addr_bit_len_t
+{
+    I2C_ADDR_BIT_LEN_7
+};
+
+struct i2c_master_bus_config_t
+{
+    i2c_port_num_t i2c_port;
+    gpio_num_t sda_io_num;
+    gpio_num_t scl_io_num;
+    i2c_clock_source_t clk_source;
+    uint8_t glitch_ignore_cnt;
+    int intr_priority;
+    size_t trans_queue_depth;
+    struct
+    {
+        uint32_t enable_internal_pullup : 1;
+    } flags;
+};
+
+struct i2c_device_config_t
+{
+    i2c_addr_bit_len_t dev_addr_length;
+    uint16_t device_address;
+    uint32_t scl_speed_hz;
+    uint32_t scl_wait_us;
+};
+
+namespace I2cMock
+{
+    class Device
+    {
+    public:
+        virtual ~Device() = default;
+        virtual esp_err_t write(const uint8_t *data, size_t size) = 0; // ESP_FAIL for a NACK
+        virtual esp_err_t read(uint8_t *data, size_t size) = 0;
+    };
+
+    inline Device *device = nullptr; // Device on the bus
+    inline uint16_t address = 0;     // Address and clock added by the driver
+    inline uint32_t clockSpeed = 0;
+}
+
+inline esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *, i2c_master_bus_handle_t *bus)
+{
+    *bus = reinterpret_cast<i2c_master_bus_handle_t>(&I2cMock::device);
+    return ESP_OK;
+}
+
+inline esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t, const i2c_device_config_t *config, i2c_master_dev_handle_t *device)
+{
+    I2cMock::address = config->device_address;
+    I2cMock::clockSpeed = config->scl_speed_hz;
+    *device = reinterpret_cast<i2c_master_dev_handle_t>(&I2cMock::device);
+    return ESP_OK;
+}
+
+inline esp_err_t i2c_master_transmit(i2c_master_dev_handle_t, const uint8_t *data, size_t size, int)
+{
+    return I2cMock::device != nullptr ? I2cMock::device->write(data, size) : ESP_FAIL;
+}
+
+inline esp_err_t i2c_master_receive(i2c_master_dev_handle_t, uint8_t *data, size_t size, int)
+{
+    return I2cMock::device != nullptr ? I2cMock::device->read(data, size) : ESP_FAIL;
+}
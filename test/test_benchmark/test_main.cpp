@@ -0,0 +1,264 @@
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Display/renderer.hpp"
+#include "Display/segmentFont.hpp"
+#include <subset/FreeMonoBold24pt7b.h>
+
+// Host benchmark of the renderer and the drawing primitives under it, run with pio test -e native -f test_benchmark -v to see the timings. The
+// states are random but seeded, every run renders the same frames. Timings are of the host CPU, they compare
+// revisions of the renderer with each other, not with the ESP32 (see DISPLAY_BENCHMARK for that).
+
+namespace
+{
+    constexpr uint16_t RANDOM_STATES = 5000;
+    constexpr uint16_t PRIMITIVE_ITERATIONS = 20000;
+    constexpr uint16_t WIDGET_ITERATIONS = 20000;
+    constexpr const char *WIDGET_NAMES[WIDGET_COUNT] = {"co2", "temperature", "humidity", "battery", "clock", "chart"};
+
+    std::mt19937 generator(1);
+    uint8_t history[CHART_COLUMNS];
+
+    uint64_t nanos()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    int32_t randomInRange(int32_t low, int32_t high) // high exclusive, like Arduino's random()
+    {
+        return std::uniform_int_distribution<int32_t>(low, high - 1)(generator);
+    }
+
+    DisplayState randomState()
+    {
+        DisplayState state;
+        state.co2 = randomInRange(400, 5001);
+        state.temperature = randomInRange(-1000, 4000);
+        state.humidity = randomInRange(0, 10001);
+        state.hours = randomInRange(0, 24);
+        state.minutes = randomInRange(0, 60);
+        state.batteryPercent = randomInRange(0, 101);
+        state.usbConnected = randomInRange(0, 2);
+        state.chartHead = randomInRange(0, CHART_COLUMNS);
+        state.chartOrigin = state.chartHead;
+        return state;
+    }
+
+    void report(const char *name, uint64_t elapsed, uint32_t count)
+    {
+        char message[96];
+        snprintf(message, sizeof(message), "%s: %.2f us per state", name, elapsed / 1000.0 / count);
+        TEST_MESSAGE(message);
+    }
+
+    // Whole frames and single widgets over random states, with pages of pageHeight rows
+    void benchmarkRandomStates(uint16_t pageHeight, bool staticLayerValid)
+    {
+        DisplayBuffer buffer(pageHeight);
+        StaticLayer staticLayer;
+        staticLayer.clear();
+        uint64_t frameTime = 0; // ns
+        uint64_t widgetTime[WIDGET_COUNT] = {};
+        for (uint16_t i = 0; i < RANDOM_STATES; i++)
+        {
+            DisplayState state = randomState();
+            if (!staticLayerValid)
+            {
+                staticLayer.clear();
+            }
+            Renderer::beginFrame(buffer, staticLayer, state, true);
+
+            uint64_t start = nanos();
+            for (uint16_t page = 0; page < buffer.getPageCount(); page++)
+            {
+                buffer.setPage(page);
+                Renderer::renderPage();
+            }
+            frameTime += nanos() - start;
+            Renderer::endFrame();
+
+            for (uint8_t widget = 0; widget < WIDGET_COUNT; widget++)
+            {
+                start = nanos();
+                for (uint16_t page = 0; page < buffer.getPageCount(); page++)
+                {
+                    buffer.setPage(page);
+                    Renderer::drawWidget(static_cast<Widget>(widget));
+                }
+                widgetTime[widget] += nanos() - start;
+            }
+        }
+
+        char name[64];
+        snprintf(name, sizeof(name), "Frame, %u rows per page, %s", pageHeight, staticLayerValid ? "static layer blitted" : "static content drawn");
+        report(name, frameTime, RANDOM_STATES);
+        for (uint8_t widget = 0; widget < WIDGET_COUNT; widget++)
+        {
+            report(WIDGET_NAMES[widget], widgetTime[widget], RANDOM_STATES);
+        }
+    }
+
+    // fillRect, drawBitmap and text through Adafruit GFX calls, the same calls as the benchmark of DISPLAY_BENCHMARK
+    template <typename Buffer>
+    void benchmarkPrimitives(Buffer &buffer, const char *name)
+    {
+        uint8_t bitmap[32 * 32 / 8];
+        for (uint8_t i = 0; i < sizeof(bitmap); i++)
+        {
+            bitmap[i] = i * 37;
+        }
+
+        uint64_t start = nanos();
+        for (uint16_t i = 0; i < PRIMITIVE_ITERATIONS; i++)
+        {
+            buffer.fillRect(i % 300, i % 200, 97, 61, i & 1);
+        }
+        uint64_t fillTime = nanos() - start;
+
+        start = nanos();
+        for (uint16_t i = 0; i < PRIMITIVE_ITERATIONS; i++)
+        {
+            buffer.drawBitmap(i % 360, i % 260, bitmap, 32, 32, 0);
+        }
+        uint64_t bitmapTime = nanos() - start;
+
+        buffer.setFont(&FreeMonoBold24pt7b);
+        buffer.setTextColor(0);
+        start = nanos();
+        for (uint16_t i = 0; i < PRIMITIVE_ITERATIONS; i++)
+        {
+            buffer.setCursor(i % 200, 50 + i % 200);
+            buffer.print("12.34");
+        }
+        uint64_t glyphTime = nanos() - start;
+
+        start = nanos();
+        for (uint16_t i = 0; i < PRIMITIVE_ITERATIONS; i++)
+        {
+            drawSegmentText(buffer, &SegmentFont<30>::FONT, "12.34", i % 200, 50 + i % 200, 0);
+        }
+        uint64_t segmentTime = nanos() - start;
+
+        char message[160];
+        snprintf(message, sizeof(message), "%s: fillRect %.0f ns, drawBitmap %.0f ns, 5 glyphs %.0f ns, 5 segment digits %.0f ns per call",
+                 name, static_cast<double>(fillTime) / PRIMITIVE_ITERATIONS, static_cast<double>(bitmapTime) / PRIMITIVE_ITERATIONS,
+                 static_cast<double>(glyphTime) / PRIMITIVE_ITERATIONS, static_cast<double>(segmentTime) / PRIMITIVE_ITERATIONS);
+        TEST_MESSAGE(message);
+    }
+
+    // Adafruit GFX with the runtime rotation of GFXcanvas1 before, the frame buffer with its compile time rotation after
+    template <uint8_t ROTATION>
+    void comparePrimitives()
+    {
+        GFXcanvas1 canvas(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+        canvas.setRotation(ROTATION);
+        FrameBuffer<DISPLAY_WIDTH, DISPLAY_HEIGHT, ROTATION> frame(DISPLAY_HEIGHT);
+        char name[48];
+        snprintf(name, sizeof(name), "GFXcanvas1, rotation %u", ROTATION);
+        benchmarkPrimitives(canvas, name);
+        snprintf(name, sizeof(name), "FrameBuffer, rotation %u", ROTATION);
+        benchmarkPrimitives(frame, name);
+
+        // Both have to draw the same pixels, otherwise the comparison is void
+        canvas.fillScreen(1);
+        frame.fillScreen(1);
+        for (uint16_t i = 0; i < 100; i++)
+        {
+            canvas.fillRect(i * 7 % 300, i * 3 % 200, 1 + i % 97, 1 + i % 61, i & 1);
+            frame.fillRect(i * 7 % 300, i * 3 % 200, 1 + i % 97, 1 + i % 61, i & 1);
+        }
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(canvas.getBuffer(), frame.getBuffer(), frame.getBufferSize());
+    }
+}
+
+void setUp()
+{
+    Renderer::setGlyphBlitter(true);
+    Renderer::setChartHistory(history);
+}
+
+void tearDown()
+{
+}
+
+void test_random_states()
+{
+    benchmarkRandomStates(DISPLAY_HEIGHT, true);
+}
+
+void test_random_states_paged()
+{
+    benchmarkRandomStates(50, true);
+}
+
+void test_random_states_without_static_layer()
+{
+    benchmarkRandomStates(DISPLAY_HEIGHT, false);
+}
+
+void test_primitives()
+{
+    comparePrimitives<0>();
+}
+
+void test_primitives_rotated()
+{
+    comparePrimitives<1>();
+}
+
+// The text widgets drawn with Adafruit GFX and with the glyph blitter, as the first part of DISPLAY_BENCHMARK
+void test_glyph_blitter()
+{
+    DisplayBuffer buffer(DISPLAY_HEIGHT);
+    StaticLayer staticLayer;
+    staticLayer.clear();
+    DisplayState state;
+    state.co2 = 1888;
+    state.temperature = 2388;
+    state.humidity = 8888;
+    Renderer::beginFrame(buffer, staticLayer, state, false);
+    for (uint8_t widget = WIDGET_CO2; widget <= WIDGET_HUMIDITY; widget++)
+    {
+        uint64_t elapsed[2];
+        std::vector<uint8_t> images[2];
+        for (uint8_t blitter = 0; blitter < 2; blitter++)
+        {
+            Renderer::setGlyphBlitter(blitter);
+            buffer.fillScreen(1);
+            uint64_t start = nanos();
+            for (uint16_t i = 0; i < WIDGET_ITERATIONS; i++)
+            {
+                Renderer::drawWidget(static_cast<Widget>(widget));
+            }
+            elapsed[blitter] = nanos() - start;
+            images[blitter].assign(buffer.getBuffer(), buffer.getBuffer() + buffer.getBufferSize());
+        }
+
+        char message[96];
+        snprintf(message, sizeof(message), "%s: GFX %.0f ns, glyph blitter %.0f ns per call", WIDGET_NAMES[widget],
+                 static_cast<double>(elapsed[0]) / WIDGET_ITERATIONS, static_cast<double>(elapsed[1]) / WIDGET_ITERATIONS);
+        TEST_MESSAGE(message);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(images[0].data(), images[1].data(), images[0].size());
+    }
+    Renderer::endFrame();
+}
+
+int main()
+{
+    for (uint16_t i = 0; i < CHART_COLUMNS; i++)
+    {
+        history[i] = randomInRange(400, 2001) / CHART_PPM_STEP;
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_random_states);
+    RUN_TEST(test_random_states_paged);
+    RUN_TEST(test_random_states_without_static_layer);
+    RUN_TEST(test_glyph_blitter);
+    RUN_TEST(test_primitives);
+    RUN_TEST(test_primitives_rotated);
+    return UNITY_END();
+}
@@ -0,0 +1,285 @@
+#include <unity.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Display/frameSnapshot.hpp"
+#include "Display/renderer.hpp"
+#include "frameImage.hpp"
+
+// Renders fixed display states on the host and compares them with the golden frames in golden/<panel>/, with
+// DISPLAY_SEGMENT_DIGITS in golden/<panel>-segment/. Every rendered frame is written to .pio/frames/ as PBM and
+// PNG. A missing or different golden frame fails the test. With UPDATE_GOLDEN=1 the golden frames are written from
+// the current renderer instead, to be checked and committed. Paths are relative to the project directory, where
+// pio test runs the test program.
+
+namespace
+{
+#if defined(DISPLAY_PANEL_290)
+    constexpr const char *PANEL = "290";
+#elif defined(DISPLAY_PANEL_750)
+    constexpr const char *PANEL = "750";
+#else
+    constexpr const char *PANEL = "420";
+#endif
+#ifdef DISPLAY_SEGMENT_DIGITS
+    constexpr const char *DIGITS = "-segment";
+#else
+    constexpr const char *DIGITS = "";
+#endif
+    constexpr uint16_t STRIDE = DisplayBuffer::STRIDE;
+    constexpr uint32_t FRAME_SIZE = static_cast<uint32_t>(STRIDE) * DISPLAY_HEIGHT;
+
+    struct Frame
+    {
+        const char *name;
+        DisplayState state;
+        bool showClock;
+        const uint8_t *history;
+    };
+
+    DisplayState makeState(uint16_t co2, int16_t temperature, uint16_t humidity, uint8_t batteryPercent)
+    {
+        DisplayState state;
+        state.co2 = co2;
+        state.temperature = temperature;
+        state.humidity = humidity;
+        state.batteryPercent = batteryPercent;
+        return state;
+    }
+
+    DisplayState withClock(DisplayState state, uint8_t hours, uint8_t minutes, bool usbConnected)
+    {
+        state.hours = hours;
+        state.minutes = minutes;
+        state.usbConnected = usbConnected;
+        return state;
+    }
+
+    DisplayState withError(DisplayState state)
+    {
+        state.error = true;
+        return state;
+    }
+
+    uint8_t emptyHistory[CHART_COLUMNS];
+    uint8_t risingHistory[CHART_COLUMNS]; // From 400 to 2100 ppm, the top is clipped
+    uint8_t noisyHistory[CHART_COLUMNS];  // Every column different, the largest frame snapshot
+
+    const Frame FRAMES[] = {
+        {"readings", makeState(1234, 2156, 4567, 80), false, emptyHistory},
+        {"clock_usb_chart", withClock(makeState(876, 1888, 5120, 35), 9, 41, true), true, risingHistory},
+        {"below_zero", makeState(412, -850, 9950, 5), false, risingHistory},
+        {"widest_values", makeState(9999, -4499, 10000, 100), false, emptyHistory},
+        {"noisy_chart", withClock(makeState(2345, 2888, 8888, 100), 23, 59, true), true, noisyHistory},
+        {"sensor_error", withError(makeState(0, 0, 0, 60)), false, emptyHistory},
+    };
+
+    std::string getFramePath(const char *directory, const char *name, const char *extension)
+    {
+        return std::string(directory) + "/" + PANEL + DIGITS + "/" + name + extension;
+    }
+
+    // Render a frame with pages of pageHeight rows into a whole frame image
+    std::vector<uint8_t> render(const Frame &frame, uint16_t pageHeight, StaticLayer &staticLayer)
+    {
+        std::vector<uint8_t> image(FRAME_SIZE);
+        DisplayBuffer buffer(pageHeight);
+        Renderer::setChartHistory(frame.history);
+        Renderer::beginFrame(buffer, staticLayer, frame.state, frame.showClock);
+        for (uint16_t page = 0; page < buffer.getPageCount(); page++)
+        {
+            buffer.setPage(page);
+            Renderer::renderPage();
+            memcpy(&image[buffer.getPageTop() * STRIDE], buffer.getBuffer(), buffer.getPageRows() * STRIDE);
+        }
+        Renderer::endFrame();
+        return image;
+    }
+
+    std::vector<uint8_t> render(const Frame &frame, uint16_t pageHeight = DISPLAY_HEIGHT)
+    {
+        StaticLayer staticLayer;
+        staticLayer.clear();
+        return render(frame, pageHeight, staticLayer);
+    }
+
+    uint32_t countDifferentPixels(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b)
+    {
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < FRAME_SIZE; i++)
+        {
+            count += __builtin_popcount(a[i] ^ b[i]);
+        }
+        return count;
+    }
+}
+
+void setUp()
+{
+    Renderer::setGlyphBlitter(true);
+}
+
+void tearDown()
+{
+}
+
+void test_golden_frames()
+{
+    bool update = getenv("UPDATE_GOLDEN") != nullptr;
+    for (const Frame &frame : FRAMES)
+    {
+        std::vector<uint8_t> image = render(frame);
+        std::filesystem::create_directories(std::filesystem::path(getFramePath(".pio/frames", frame.name, "")).parent_path());
+        FrameImage::writePbm(getFramePath(".pio/frames", frame.name, ".pbm").c_str(), image.data(), DISPLAY_WIDTH, DISPLAY_HEIGHT);
+        FrameImage::writePng(getFramePath(".pio/frames", frame.name, ".png").c_str(), image.data(), DISPLAY_WIDTH, DISPLAY_HEIGHT);
+
+        std::string goldenPath = getFramePath("test/test_renderer/golden", frame.name, ".pbm");
+        if (update)
+        {
+            std::filesystem::create_directories(std::filesystem::path(goldenPath).parent_path());
+            TEST_ASSERT_TRUE(FrameImage::writePbm(goldenPath.c_str(), image.data(), DISPLAY_WIDTH, DISPLAY_HEIGHT));
+            continue;
+        }
+
+        std::vector<uint8_t> golden;
+        if (!FrameImage::readPbm(goldenPath.c_str(), golden, DISPLAY_WIDTH, DISPLAY_HEIGHT))
+        {
+            std::string message = goldenPath + " is missing, write it with UPDATE_GOLDEN=1";
+            TEST_FAIL_MESSAGE(message.c_str());
+        }
+
+        std::string message = std::string(frame.name) + " differs from " + goldenPath + ", see .pio/frames";
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, countDifferentPixels(image, golden), message.c_str());
+    }
+}
+
+// Pages of any height, also ones that split glyphs and do not divide the panel, add up to the whole frame
+void test_pages_match_whole_frame()
+{
+    for (const Frame &frame : FRAMES)
+    {
+        std::vector<uint8_t> whole = render(frame);
+        for (uint16_t pageHeight : {100, 50, 7, 1})
+        {
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, countDifferentPixels(whole, render(frame, pageHeight)), frame.name);
+        }
+    }
+}
+
+// The static layer captured by the first frame reproduces the grid lines and labels it replaces
+void test_static_layer_matches_drawn_content()
+{
+    for (const Frame &frame : FRAMES)
+    {
+        StaticLayer staticLayer;
+        staticLayer.clear();
+        std::vector<uint8_t> drawn = render(frame, 50, staticLayer);
+        TEST_ASSERT_TRUE_MESSAGE(frame.state.error || staticLayer.isValid(), frame.name);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, countDifferentPixels(drawn, render(frame, 50, staticLayer)), frame.name);
+    }
+}
+
+void test_glyph_blitter_matches_gfx()
+{
+    for (const Frame &frame : FRAMES)
+    {
+        Renderer::setGlyphBlitter(false);
+        std::vector<uint8_t> gfx = render(frame);
+        Renderer::setGlyphBlitter(true);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, countDifferentPixels(gfx, render(frame)), frame.name);
+    }
+}
+
+// Partial updates refresh the widget bounds only, a widget must not draw outside of them
+void test_widgets_stay_in_bounds()
+{
+    for (const Frame &frame : FRAMES)
+    {
+        if (frame.state.error)
+            continue;
+
+        DisplayBuffer buffer(DISPLAY_HEIGHT);
+        StaticLayer staticLayer;
+        staticLayer.clear();
+        Renderer::setChartHistory(frame.history);
+        Renderer::beginFrame(buffer, staticLayer, frame.state, frame.showClock);
+        Renderer::renderPage();
+        for (uint8_t widget = 0; widget < WIDGET_COUNT; widget++)
+        {
+            if (widget == WIDGET_CLOCK && !frame.showClock)
+                continue;
+
+            buffer.fillScreen(1);
+            Renderer::drawWidget(static_cast<Widget>(widget));
+            const Rect &bounds = Renderer::getBounds(static_cast<Widget>(widget));
+            for (int16_t y = 0; y < DISPLAY_HEIGHT; y++)
+            {
+                for (int16_t x = 0; x < DISPLAY_WIDTH; x++)
+                {
+                    bool black = !(buffer.getBuffer()[y * STRIDE + x / 8] & (0x80 >> (x & 7)));
+                    bool inside = x >= bounds.x && x < bounds.x + bounds.w && y >= bounds.y && y < bounds.y + bounds.h;
+                    TEST_ASSERT_FALSE_MESSAGE(black && !inside, frame.name);
+                }
+            }
+        }
+        Renderer::endFrame();
+    }
+}
+
+// The static layer and the frame snapshot of every frame fit the RTC memory budgets of the panel
+void test_frames_fit_rtc_budgets()
+{
+    static uint8_t scratch[FrameSnapshot::BUDGET];
+    uint16_t largestSnapshot = 0;
+    for (const Frame &frame : FRAMES)
+    {
+        StaticLayer staticLayer;
+        staticLayer.clear();
+        std::vector<uint8_t> image = render(frame, DISPLAY_HEIGHT, staticLayer);
+        TEST_ASSERT_TRUE_MESSAGE(frame.state.error || staticLayer.isValid(), frame.name);
+
+        FrameSnapshot snapshot;
+        snapshot.invalidate();
+        std::vector<uint32_t> changedWords(DISPLAY_HEIGHT);
+        snapshot.begin(STRIDE, DISPLAY_HEIGHT, scratch);
+        snapshot.diffPage(image.data(), DISPLAY_HEIGHT, changedWords.data());
+        snapshot.storePage(image.data(), DISPLAY_HEIGHT);
+        TEST_ASSERT_TRUE_MESSAGE(snapshot.commit(), frame.name);
+        largestSnapshot = std::max(largestSnapshot, snapshot.size());
+
+        // Diffing the same frame against the snapshot finds nothing
+        snapshot.begin(STRIDE, DISPLAY_HEIGHT, scratch);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, snapshot.diffPage(image.data(), DISPLAY_HEIGHT, changedWords.data()), frame.name);
+        snapshot.storePage(image.data(), DISPLAY_HEIGHT);
+        snapshot.commit();
+    }
+
+    char message[96];
+    snprintf(message, sizeof(message), "Largest frame snapshot %u of %u bytes", largestSnapshot, FrameSnapshot::BUDGET);
+    TEST_MESSAGE(message);
+}
+
+int main()
+{
+    uint32_t seed = 1;
+    for (uint16_t i = 0; i < CHART_COLUMNS; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        emptyHistory[i] = 0;
+        risingHistory[i] = (400 + i * 1700 / CHART_COLUMNS) / CHART_PPM_STEP;
+        noisyHistory[i] = (400 + (seed >> 16) % 1601) / CHART_PPM_STEP;
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_golden_frames);
+    RUN_TEST(test_pages_match_whole_frame);
+    RUN_TEST(test_static_layer_matches_drawn_content);
+    RUN_TEST(test_glyph_blitter_matches_gfx);
+    RUN_TEST(test_widgets_stay_in_bounds);
+    RUN_TEST(test_frames_fit_rtc_budgets);
+    return UNITY_END();
+}
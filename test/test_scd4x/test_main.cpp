@@ -0,0 +1,393 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "Sensor/scd4x.hpp"
+
+// The SCD4x driver against a model of the sensor on the mock I2C bus of test/shim: command encoding, CRCs,
+// conversions, and the transfers of a wake compared with the SparkFun library the driver replaced.
+// Time is the sum of all delay() calls, the tests stand in for light and deep sleep with delay() as well.
+
+namespace
+{
+    constexpr uint32_t CONVERSION_TIME = 5000;    // ms of a single shot, Sensor::CONVERSION_TIME
+    constexpr uint32_t CONVERSION_TIME_RHT = 50;  // ms of a temperature and humidity single shot
+    constexpr uint32_t POLL_INTERVAL = 2400;      // ms of light sleep between data ready polls, SENSOR_SLOW_SLEEP_TIME
+    constexpr uint32_t WIRE_CLOCK_SPEED = 100000; // Wire default the SparkFun library ran at
+
+    // CRC-8 of the datasheet, bit by bit to check the table of the driver
+    uint8_t getCrc(const uint8_t *word)
+    {
+        uint8_t crc = 0xFF;
+        for (uint8_t i = 0; i < 2; i++)
+        {
+            crc ^= word[i];
+            for (uint8_t bit = 0; bit < 8; bit++)
+            {
+                crc = crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1;
+            }
+        }
+        return crc;
+    }
+
+    struct Transfer
+    {
+        bool read;
+        uint16_t command; // Command of the write, or the one read back
+        size_t size;      // Bytes without the address
+        uint32_t clockSpeed;
+    };
+
+    // SCD41 in idle single shot mode. Reads of a measurement are not acknowledged while none is ready.
+    class Scd41Model : public I2cMock::Device
+    {
+    public:
+        uint16_t co2 = 500;
+        uint16_t temperatureRaw = 0x6667; // 25 C, the example of the datasheet
+        uint16_t humidityRaw = 0x5EB9;    // 37 %
+        uint16_t temperatureOffsetRaw = 0x0912;
+        uint16_t selfCalibration = 1;
+        bool corruptCrc = false;
+        std::vector<Transfer> transfers;
+
+        esp_err_t write(const uint8_t *data, size_t size) override
+        {
+            if (size != 2 && size != 5)
+                return ESP_FAIL;
+            uint16_t command = data[0] << 8 | data[1];
+            uint16_t argument = size == 5 ? data[2] << 8 | data[3] : 0;
+            if (size == 5 && getCrc(&data[2]) != data[4])
+                return ESP_FAIL;
+
+            transfers.push_back({false, command, size, I2cMock::clockSpeed});
+            mCommand = command;
+            mResponse.clear();
+            switch (command)
+            {
+            case 0x219D: // measure_single_shot
+            case 0x2196: // measure_single_shot_rht_only
+                mMeasurementStart = Shim::delayed;
+                mConversionTime = command == 0x219D ? CONVERSION_TIME : CONVERSION_TIME_RHT;
+                mMeasuring = true;
+                break;
+            case 0xE4B8: // get_data_ready_status
+                respond({static_cast<uint16_t>(isReady() ? 0x8006 : 0x8000)});
+                break;
+            case 0xEC05: // read_measurement
+                if (isReady())
+                {
+                    respond({co2, temperatureRaw, humidityRaw});
+                    mMeasuring = false;
+                }
+                break;
+            case 0x3682: // get_serial_number
+                respond({0xF896, 0x9F07, 0x3BB4});
+                break;
+            case 0x202F: // get_sensor_variant
+                respond({0x1440});
+                break;
+            case 0x241D: // set_temperature_offset
+                temperatureOffsetRaw = argument;
+                break;
+            case 0x2318: // get_temperature_offset
+                respond({temperatureOffsetRaw});
+                break;
+            case 0x2322: // get_sensor_altitude
+                respond({0});
+                break;
+            case 0x2416: // set_automatic_self_calibration_enabled
+                selfCalibration = argument;
+                break;
+            case 0x2313: // get_automatic_self_calibration_enabled
+                respond({selfCalibration});
+                break;
+            default:
+                transfers.pop_back();
+                return ESP_FAIL;
+            }
+            return ESP_OK;
+        }
+
+        esp_err_t read(uint8_t *data, size_t size) override
+        {
+            if (size == 0 || size > mResponse.size())
+                return ESP_FAIL; // Nothing to read, the sensor does not acknowledge
+
+            transfers.push_back({true, mCommand, size, I2cMock::clockSpeed});
+            std::copy(mResponse.begin(), mResponse.begin() + size, data);
+            mResponse.clear();
+            return ESP_OK;
+        }
+
+    private:
+        uint16_t mCommand = 0;
+        std::vector<uint8_t> mResponse;
+        uint32_t mMeasurementStart = 0;
+        uint32_t mConversionTime = 0;
+        bool mMeasuring = false;
+
+        bool isReady() const
+        {
+            return mMeasuring && Shim::delayed - mMeasurementStart >= mConversionTime;
+        }
+
+        void respond(std::initializer_list<uint16_t> words)
+        {
+            for (uint16_t word : words)
+            {
+                uint8_t bytes[2] = {static_cast<uint8_t>(word >> 8), static_cast<uint8_t>(word)};
+                mResponse.insert(mResponse.end(), {bytes[0], bytes[1], static_cast<uint8_t>(getCrc(bytes) ^ corruptCrc)});
+            }
+        }
+    };
+
+    // Transfers of the SparkFun SCD4x Arduino Library 1.1 as the firmware used it before the driver: Wire at
+    // its default clock, every response read after delay(1). begin(false, false, true) reads the feature set
+    // and the serial number, readMeasurement(), called by getCO2(), asks getDataReadyStatus() first.
+    namespace SparkFun
+    {
+        void sendCommand(uint16_t command)
+        {
+            uint8_t bytes[2] = {static_cast<uint8_t>(command >> 8), static_cast<uint8_t>(command)};
+            I2cMock::device->write(bytes, sizeof(bytes));
+        }
+
+        bool readRegister(uint16_t command, uint16_t *words, uint8_t count)
+        {
+            uint8_t bytes[9];
+            sendCommand(command);
+            delay(1);
+            if (I2cMock::device->read(bytes, count * 3) != ESP_OK)
+                return false;
+            for (uint8_t i = 0; i < count; i++)
+            {
+                words[i] = bytes[i * 3] << 8 | bytes[i * 3 + 1];
+            }
+            return true;
+        }
+
+        bool begin()
+        {
+            uint16_t words[3];
+            return readRegister(0x202F, words, 1) && readRegister(0x3682, words, 3);
+        }
+
+        bool getDataReadyStatus()
+        {
+            uint16_t status;
+            return readRegister(0xE4B8, &status, 1) && (status & 0x07FF) != 0;
+        }
+
+        bool readMeasurement()
+        {
+            uint16_t words[3];
+            return getDataReadyStatus() && readRegister(0xEC05, words, 3);
+        }
+    }
+
+    struct WakeCost
+    {
+        uint32_t transfers = 0;
+        uint32_t bytes = 0;
+        uint32_t busTime = 0;      // us on the bus, 9 clocks per byte including the address byte
+        uint32_t commandDelay = 0; // ms waited for command execution
+        uint32_t polls = 0;        // Light sleeps waiting for the result within the wake
+    };
+
+    WakeCost getCost(const Scd41Model &model, uint32_t delayed, uint32_t slept, uint32_t polls)
+    {
+        WakeCost cost;
+        for (const Transfer &transfer : model.transfers)
+        {
+            cost.transfers++;
+            cost.bytes += transfer.size;
+            cost.busTime += (transfer.size + 1) * 9 * 1000000ULL / transfer.clockSpeed;
+        }
+        cost.commandDelay = delayed - slept;
+        cost.polls = polls;
+        return cost;
+    }
+
+    void report(const char *name, const WakeCost &cost)
+    {
+        char message[128];
+        snprintf(message, sizeof(message), "%s: %lu transfers, %lu bytes, %lu us on the bus, %lu ms command delays, %lu polls", name,
+                 static_cast<unsigned long>(cost.transfers), static_cast<unsigned long>(cost.bytes), static_cast<unsigned long>(cost.busTime),
+                 static_cast<unsigned long>(cost.commandDelay), static_cast<unsigned long>(cost.polls));
+        TEST_MESSAGE(message);
+    }
+
+    // A wake of the firmware before the driver: probe, start the measurement, poll until it is ready, read it
+    WakeCost runSparkFunWake()
+    {
+        Scd41Model model;
+        I2cMock::device = &model;
+        I2cMock::clockSpeed = WIRE_CLOCK_SPEED;
+        uint32_t start = Shim::delayed;
+        uint32_t slept = 0;
+        uint32_t polls = 0;
+
+        TEST_ASSERT_TRUE(SparkFun::begin());
+        SparkFun::sendCommand(0x219D);
+        while (!SparkFun::getDataReadyStatus())
+        {
+            delay(POLL_INTERVAL);
+            slept += POLL_INTERVAL;
+            polls++;
+        }
+        TEST_ASSERT_TRUE(SparkFun::readMeasurement());
+        return getCost(model, Shim::delayed - start, slept, polls);
+    }
+
+    // A deep sleep wake with the driver: read the measurement started by the previous wake, start the next one
+    WakeCost runDriverWake(Scd4x &scd4x, Scd41Model &model)
+    {
+        model.transfers.clear();
+        uint32_t start = Shim::delayed;
+        Scd4x::Reading reading;
+        TEST_ASSERT_TRUE(scd4x.begin(14, 8));
+        TEST_ASSERT_TRUE(scd4x.readMeasurement(reading));
+        TEST_ASSERT_TRUE(scd4x.measureSingleShot());
+        return getCost(model, Shim::delayed - start, 0, 0);
+    }
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+    I2cMock::device = nullptr;
+}
+
+void test_conversion()
+{
+    Scd41Model model;
+    I2cMock::device = &model;
+    Scd4x scd4x;
+    TEST_ASSERT_TRUE(scd4x.begin(14, 8));
+    TEST_ASSERT_EQUAL_UINT16(0x62, I2cMock::address);
+    TEST_ASSERT_EQUAL_UINT32(400000, I2cMock::clockSpeed);
+
+    Scd4x::Reading reading;
+    TEST_ASSERT_TRUE(scd4x.measureSingleShot());
+    delay(CONVERSION_TIME);
+    TEST_ASSERT_TRUE(scd4x.readMeasurement(reading));
+    TEST_ASSERT_EQUAL_UINT16(500, reading.co2);
+    TEST_ASSERT_EQUAL_INT16(2500, reading.temperature);
+    TEST_ASSERT_EQUAL_UINT16(3700, reading.humidity);
+
+    // -10 C, below zero the temperature stays signed
+    model.temperatureRaw = 13107;
+    model.humidityRaw = 0xFFFF;
+    TEST_ASSERT_TRUE(scd4x.measureSingleShot());
+    delay(CONVERSION_TIME);
+    TEST_ASSERT_TRUE(scd4x.readMeasurement(reading));
+    TEST_ASSERT_EQUAL_INT16(-1000, reading.temperature);
+    TEST_ASSERT_EQUAL_UINT16(10000, reading.humidity);
+
+    // The lowest raw value is -45 C
+    model.temperatureRaw = 0;
+    TEST_ASSERT_TRUE(scd4x.measureSingleShot());
+    delay(CONVERSION_TIME);
+    TEST_ASSERT_TRUE(scd4x.readMeasurement(reading));
+    TEST_ASSERT_EQUAL_INT16(-4500, reading.temperature);
+
+    uint64_t serial;
+    TEST_ASSERT_TRUE(scd4x.getSerialNumber(serial));
+    TEST_ASSERT_EQUAL_UINT64(0xF8969F073BB4ULL, serial);
+    uint8_t variant;
+    TEST_ASSERT_TRUE(scd4x.getSensorVariant(variant));
+    TEST_ASSERT_EQUAL_UINT8(1, variant);
+}
+
+void test_crc()
+{
+    const uint8_t example[2] = {0xBE, 0xEF};
+    TEST_ASSERT_EQUAL_HEX8(0x92, getCrc(example)); // Example of the datasheet
+
+    Scd41Model model;
+    I2cMock::device = &model;
+    Scd4x scd4x;
+    TEST_ASSERT_TRUE(scd4x.begin(14, 8));
+    uint64_t serial;
+    model.corruptCrc = true;
+    TEST_ASSERT_FALSE(scd4x.getSerialNumber(serial));
+    model.corruptCrc = false;
+    TEST_ASSERT_TRUE(scd4x.getSerialNumber(serial));
+
+    // Arguments carry a CRC as well, the model refuses writes with a wrong one
+    int16_t offset;
+    TEST_ASSERT_TRUE(scd4x.setTemperatureOffset(400));
+    TEST_ASSERT_TRUE(scd4x.getTemperatureOffset(offset));
+    TEST_ASSERT_EQUAL_INT16(399, offset); // 4 C in steps of 175 C / 65535
+    bool enabled = true;
+    TEST_ASSERT_TRUE(scd4x.setAutomaticSelfCalibration(false));
+    TEST_ASSERT_TRUE(scd4x.getAutomaticSelfCalibration(enabled));
+    TEST_ASSERT_FALSE(enabled);
+}
+
+// Reading before the conversion is done fails instead of returning an old value
+void test_result_not_ready()
+{
+    Scd41Model model;
+    I2cMock::device = &model;
+    Scd4x scd4x;
+    TEST_ASSERT_TRUE(scd4x.begin(14, 8));
+
+    Scd4x::Reading reading;
+    bool ready = true;
+    TEST_ASSERT_TRUE(scd4x.measureSingleShotRhtOnly());
+    TEST_ASSERT_FALSE(scd4x.readMeasurement(reading));
+    TEST_ASSERT_TRUE(scd4x.getDataReady(ready));
+    TEST_ASSERT_FALSE(ready);
+    delay(CONVERSION_TIME_RHT);
+    TEST_ASSERT_TRUE(scd4x.getDataReady(ready));
+    TEST_ASSERT_TRUE(ready);
+    TEST_ASSERT_TRUE(scd4x.readMeasurement(reading));
+    TEST_ASSERT_FALSE(scd4x.readMeasurement(reading)); // A result is read once
+}
+
+// One wake of the firmware with the SparkFun library against the driver. The driver starts a measurement, the
+// device sleeps through the conversion and the next wake reads it without asking whether it is ready.
+void test_wake_against_sparkfun()
+{
+    WakeCost before = runSparkFunWake();
+
+    Scd41Model model;
+    I2cMock::device = &model;
+    Scd4x scd4x;
+    uint32_t start = Shim::delayed;
+    uint64_t serial;
+    uint8_t variant;
+    TEST_ASSERT_TRUE(scd4x.begin(14, 8));
+    TEST_ASSERT_TRUE(scd4x.getSerialNumber(serial)); // Cold boot, probed and configured once
+    TEST_ASSERT_TRUE(scd4x.getSensorVariant(variant));
+    TEST_ASSERT_TRUE(scd4x.setAutomaticSelfCalibration(false));
+    TEST_ASSERT_TRUE(scd4x.measureSingleShot());
+    WakeCost coldBoot = getCost(model, Shim::delayed - start, 0, 0);
+    delay(CONVERSION_TIME); // Deep sleep
+    WakeCost after = runDriverWake(scd4x, model);
+
+    report("SparkFun wake", before);
+    report("Driver cold boot", coldBoot);
+    report("Driver wake", after);
+    TEST_ASSERT_EQUAL_UINT32(3, after.transfers); // Command and read of the result, command of the next shot
+    TEST_ASSERT_EQUAL_UINT32(0, after.polls);
+    TEST_ASSERT_LESS_THAN_UINT32(before.transfers, after.transfers);
+    TEST_ASSERT_LESS_THAN_UINT32(before.busTime, after.busTime);
+    TEST_ASSERT_LESS_THAN_UINT32(before.commandDelay, after.commandDelay);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_conversion);
+    RUN_TEST(test_crc);
+    RUN_TEST(test_result_not_ready);
+    RUN_TEST(test_wake_against_sparkfun);
+    return UNITY_END();
+}